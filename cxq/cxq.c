@@ -4,13 +4,252 @@
 
 *******************************************************************************/
 
+#ifdef __linux__
+#define _GNU_SOURCE         /* memfd_create */
+#endif
+
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#endif
+#if defined(MULTI_THREAD) && defined(CXQ_POSIX)
+#include <errno.h>
+#endif
+#if !defined(MULTI_THREAD) || defined(CXQ_POSIX)
+#include <time.h>
+#endif
 
 #include "cxq.h"
 
 //#define TEST_CXQ
 
+/* Max count for the wakeup semaphores. */
+#define CXQ_SEM_MAX 0xFFFF
+
+/* Signal the eventfd or cxq_watch callback for `sem` if n elements
+   added (not_empty) or removed (not_full) just crossed the empty or
+   full edge. */
+#define EDGE_N(q, sem, n)   _cxq_edge_##sem(q, n)
+
+/* Wake up to n threads parked in a cxq_*_wait call.  WAKE_PARKED skips
+   the edge signal.  Lock must be held. */
+#ifdef MULTI_THREAD
+#define WAKE_PARKED(q, waiting, sem, n) \
+    do { \
+        for (int _i = (n); _i > 0 && (q)->waiting > 0; _i--) { \
+            (q)->waiting--; \
+            SEM_SIGNAL((q)->sem); \
+        } \
+    } while (0)
+#define WAKE_N(q, waiting, sem, n) \
+    do { \
+        EDGE_N(q, sem, n); \
+        WAKE_PARKED(q, waiting, sem, n); \
+    } while (0)
+#else
+#define WAKE_PARKED(q, waiting, sem, n) NOP
+#define WAKE_N(q, waiting, sem, n) EDGE_N(q, sem, n)
+#endif
+#define WAKE_ONE(q, waiting, sem) WAKE_N(q, waiting, sem, 1)
+
+/* Bump a CXQ_STATS counter. */
+#ifdef CXQ_STATS
+#define STAT_ADD(q, field, n)   ((q)->stats.field += (n))
+#else
+#define STAT_ADD(q, field, n)   NOP
+#endif
+
+/* Monotonic time in ns, for CXQ_STATS and CXQ_OPT_TIMESTAMP.  Define
+   CXQ_NOW_NS() to supply another clock. */
+#ifndef CXQ_NOW_NS
+static inline uint64_t _cxq_now_ns(void) {
+#if defined(MULTI_THREAD) && !defined(CXQ_POSIX)
+    return (uint64_t)osKernelGetTickCount() * 1000000000ULL
+           / osKernelGetTickFreq();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+#define CXQ_NOW_NS()    _cxq_now_ns()
+#endif
+
+/* Take the queue lock.  With CXQ_STATS, time waits for a taken mutex. */
+#if defined(CXQ_STATS) && defined(MULTI_THREAD)
+static void _cxq_lock(cxq_t *q) {
+    if (TRYLOCK(q->lock))
+        return;
+    uint64_t t0 = CXQ_NOW_NS();
+    LOCK(q->lock);
+    q->stats.lock_waits++;
+    q->stats.lock_wait_ns += CXQ_NOW_NS() - t0;
+}
+#define QLOCK(q)    _cxq_lock(q)
+#else
+#define QLOCK(q)    LOCK((q)->lock)
+#endif
+
+
+#if defined(MULTI_THREAD) && defined(CXQ_POSIX)
+/*
+  Description
+    POSIX backend for SEM_WAIT.
+
+  Parameters
+    sem        - Pointer to semaphore.
+    timeout    - Max time to wait in ms, 0 to poll, or CXQ_WAIT_FOREVER.
+
+  Returns
+    0 if the semaphore was acquired, -1 on timeout.
+*/
+int cxq_sem_wait(cxq_sem_t *sem, uint32_t timeout) {
+    struct timespec ts;
+    int rc;
+    if (timeout == 0)
+        return sem_trywait(sem);
+    if (timeout == CXQ_WAIT_FOREVER) {
+        while ((rc = sem_wait(sem)) != 0 && errno == EINTR)
+            ;
+        return rc;
+    }
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout / 1000;
+    ts.tv_nsec += (timeout % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    while ((rc = sem_timedwait(sem, &ts)) != 0 && errno == EINTR)
+        ;
+    return rc;
+}
+#endif /* MULTI_THREAD && CXQ_POSIX */
+
+
+#ifdef __linux__
+/* Round slots up so that slots * stride is a whole number of pages.
+   The page size is a power of two, so the multiple is too. */
+static int _cxq_mirror_slots(int slots, int stride) {
+    long page = sysconf(_SC_PAGESIZE);
+    long low = stride & -stride;            /* gcd(page, stride) */
+    int unit = page / (low < page ? low : page);
+    return (slots + unit - 1) / unit * unit;
+}
+
+
+/*
+  Description
+    Map `bytes` of fresh memory twice, back to back, so that writes
+    past the end of the first copy land at the start of it.
+
+  Returns
+    Pointer to the first copy, or NULL on failure.
+*/
+static void * _cxq_mirror_alloc(size_t bytes) {
+    int fd = memfd_create("cxq", MFD_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    if (ftruncate(fd, bytes) < 0) {
+        close(fd);
+        return NULL;
+    }
+    /* Reserve address space for both copies, then map over it. */
+    char *base = mmap(NULL, 2 * bytes, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, bytes, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+        || mmap(base + bytes, bytes, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * bytes);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    return base;
+}
+
+
+/* Round bytes up to whole hugepages. */
+static size_t _cxq_huge_len(size_t bytes) {
+    return (bytes + CXQ_HUGEPAGE_SIZE - 1) / CXQ_HUGEPAGE_SIZE
+           * CXQ_HUGEPAGE_SIZE;
+}
+
+
+/*
+  Description
+    Map `bytes` of memory backed by hugepages.  Tries reserved hugepages
+    (MAP_HUGETLB) first, then a hugepage-aligned mapping marked for
+    transparent hugepages.
+
+  Returns
+    Pointer to the memory, or NULL on failure.
+*/
+static void * _cxq_huge_alloc(size_t bytes) {
+    size_t len = _cxq_huge_len(bytes);
+    char *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED)
+        return p;
+    /* Over-map by one hugepage and trim, so the range is aligned. */
+    p = mmap(NULL, len + CXQ_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+    char *start = (char *)(((uintptr_t)p + CXQ_HUGEPAGE_SIZE - 1)
+                           & ~(uintptr_t)(CXQ_HUGEPAGE_SIZE - 1));
+    if (start > p)
+        munmap(p, start - p);
+    munmap(start + len, p + CXQ_HUGEPAGE_SIZE - start);
+#ifdef MADV_HUGEPAGE
+    madvise(start, len, MADV_HUGEPAGE);
+#endif
+    return start;
+}
+#endif /* __linux__ */
+
+
+/* Allocate a body of `slots` slots the way q->options asks for. */
+static void * _cxq_body_alloc(cxq_t *q, int slots) {
+    size_t bytes = (size_t)slots * q->stride;
+    size_t align = (unsigned)q->options >> 16;
+#ifdef __linux__
+    if (q->options & CXQ_OPT_MIRROR)
+        return _cxq_mirror_alloc(bytes);
+    if (q->options & CXQ_OPT_HUGEPAGE)
+        return _cxq_huge_alloc(bytes);
+#endif
+    if (q->handlers->malloc_fn == malloc && align > _Alignof(max_align_t))
+        return aligned_alloc(align, bytes);
+    if (q->handlers->malloc_fn)
+        return q->handlers->malloc_fn(bytes);
+    return NULL;
+}
+
+
+/* Free a body of `slots` slots from _cxq_body_alloc. */
+static void _cxq_body_free(cxq_t *q, void *data, int slots) {
+    size_t bytes = (size_t)slots * q->stride;
+#ifdef __linux__
+    if (q->options & CXQ_OPT_MIRROR)
+        munmap(data, 2 * bytes);
+    else if (q->options & CXQ_OPT_HUGEPAGE)
+        munmap(data, _cxq_huge_len(bytes));
+    else
+#endif
+    if (q->handlers->free_fn)
+        q->handlers->free_fn(data);
+}
+
 
 /*
   Description
@@ -27,25 +266,184 @@
     None
 */
 void cxq_init(cxq_t *q, int slots, int data_size, memfuns_t *handlers) {
+    cxq_init_ex(q, slots, data_size, handlers, CXQ_OPT_NONE);
+}
+
+
+/*
+  Description
+    Init the queue with options.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    slots      - Number of queue positions. 
+    data_size  - The size of each queue element.
+    handlers   - Pointer to memfuns_t stuct that manages memory allocation
+                 for queue elements. 
+    options    - CXQ_OPT_* flags, or'ed together.
+
+  Returns
+    None
+
+  Note
+    CXQ_OPT_SPSC makes the queue lock-free for exactly one producer
+    thread and one consumer thread.  The producer owns `tail` and the
+    consumer owns `head`; each publishes its index with a release store
+    and reads the other's with an acquire load, so LOCK is never taken.
+    In this mode:
+      - cxq_enqueue, cxq_enqueue_n and cxq_reserve/cxq_commit are
+        producer-only.
+      - cxq_dequeue, cxq_dequeue_n, cxq_peek/cxq_release, cxq_peek_span,
+        cxq_flush and cxq_traverse are consumer-only.
+      - cxq_enqueue_front always returns NULL, because the head
+        belongs to the consumer.
+      - cxq_set_first and cxq_set_circular are ignored; a full queue
+        rejects new elements instead of overwriting the oldest.
+      - A pointer returned by cxq_dequeue(q, NULL, true) may be
+        overwritten by the producer as soon as the call returns; use
+        cxq_peek/cxq_release instead.
+      - cxq_enqueue_wait and cxq_dequeue_wait only poll; they never park.
+
+    CXQ_OPT_POW2 rounds `slots` up to a power of two, so slot indexes
+    are computed with a mask instead of an integer divide, and SPSC
+    positions become free-running counters.  Leave it off if the queue
+    must hold exactly `slots` elements.  A statically supplied data
+    array must be sized for the rounded-up count, cxq_pow2_roundup(slots).
+
+    CXQ_OPT_MIRROR (Linux only) maps the queue body twice, back to back,
+    so the `count` elements from `first` are always one contiguous range,
+    see cxq_peek_span.  `slots` is rounded up so the body is a whole
+    number of pages.  The body comes from memfd_create/mmap, so
+    malloc_fn/free_fn are not called; use it for plain data.  If the
+    mapping fails, the queue falls back to malloc_fn and the flag is
+    cleared.
+
+    CXQ_OPT_ALIGN(n) aligns the body and every slot to `n` bytes, a power
+    of two up to 16384, by rounding the slot stride up from `data_size`.
+    CXQ_OPT_CACHE_ALIGN uses CXQ_CACHE_LINE, so no element straddles two
+    cache lines.  The body takes `slots` times the stride.  The default
+    malloc is replaced with aligned_alloc; a custom malloc_fn must return
+    memory aligned to `n` itself.
+
+    CXQ_OPT_HUGEPAGE (Linux only) maps the body from hugepages, rounded
+    up to CXQ_HUGEPAGE_SIZE, to cut TLB misses on queues of several MB.
+    Reserved hugepages are used if there are any, else transparent
+    hugepages are requested.  As with CXQ_OPT_MIRROR, malloc_fn/free_fn
+    are not called, and the flag is cleared if the mapping fails.  It is
+    ignored with CXQ_OPT_MIRROR.
+
+    Define CXQ_CACHE_ALIGN to also put the SPSC producer and consumer
+    positions on cache lines of their own.
+
+    CXQ_OPT_TIMESTAMP keeps a monotonic timestamp per slot, in an array
+    beside the body so the element layout is unchanged.  Each element is
+    stamped when it's enqueued or committed, and its residence time is
+    added to a histogram when it's dequeued or released; see
+    cxq_get_hist.  Elements dropped by cxq_flush or circular overwrite
+    are not recorded.
+
+    CXQ_OPT_EVENTFD (Linux only) creates an eventfd that is signaled
+    each time the queue goes from empty to not empty, see cxq_get_fd.
+    CXQ_OPT_EVENTFD_SPACE creates another, signaled when it goes from
+    full to not full, see cxq_get_space_fd.  Either flag is cleared if
+    eventfd fails.
+*/
+void cxq_init_ex(cxq_t *q, int slots, int data_size, memfuns_t *handlers,
+                 int options) {
+    int align = (unsigned)options >> 16;
+    int stride = align ? (data_size + align - 1) & ~(align - 1) : data_size;
+#ifdef __linux__
+    if (options & CXQ_OPT_MIRROR) {
+        slots = _cxq_mirror_slots(slots, stride);
+        options &= ~CXQ_OPT_HUGEPAGE;
+    }
+#else
+    options &= ~(CXQ_OPT_MIRROR | CXQ_OPT_HUGEPAGE);
+#endif
+    if (options & CXQ_OPT_POW2)
+        slots = cxq_pow2_roundup(slots);
     q->first = 0;
     q->count = 0;
     q->slots = slots;
+    q->mask = slots - 1;
     q->circular = false;
+    q->reserved = false;
+    q->held = false;
     q->data_size = data_size;
+    q->stride = stride;
+    q->options = options;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->head_cache = 0;
+    q->tail_cache = 0;
+#ifdef CXQ_STATS
+    memset(&q->stats, 0, sizeof(q->stats));
+    q->dequeued = 0;
+#endif
+    q->fd = -1;
+    q->space_fd = -1;
+    q->notify_fn = NULL;
+#ifdef __linux__
+    if (options & CXQ_OPT_EVENTFD) {
+        q->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (q->fd < 0)
+            q->options &= ~CXQ_OPT_EVENTFD;
+    }
+    if (options & CXQ_OPT_EVENTFD_SPACE) {
+        q->space_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (q->space_fd < 0)
+            q->options &= ~CXQ_OPT_EVENTFD_SPACE;
+    }
+#else
+    q->options &= ~(CXQ_OPT_EVENTFD | CXQ_OPT_EVENTFD_SPACE);
+#endif
+    q->stamps = NULL;
+    q->hist = NULL;
+    if (options & CXQ_OPT_TIMESTAMP) {
+        q->stamps = malloc(slots * sizeof(q->stamps[0]));
+        q->hist = calloc(1, sizeof(cxq_hist_t));
+        if (!q->stamps || !q->hist) {
+            free(q->stamps);
+            free(q->hist);
+            q->stamps = NULL;
+            q->hist = NULL;
+            q->options &= ~CXQ_OPT_TIMESTAMP;
+        }
+    }
     q->handlers = malloc(sizeof(memfuns_t));
     if (handlers) {
         q->handlers->malloc_fn = handlers->malloc_fn;
         q->handlers->free_fn = handlers->free_fn;
         q->handlers->memcpy_fn = handlers->memcpy_fn;
+        q->handlers->move_fn = handlers->move_fn;
+        q->handlers->swap_fn = handlers->swap_fn;
     } else {
         /* Default handlers. */
         q->handlers->malloc_fn = malloc;
         q->handlers->free_fn = free;
         q->handlers->memcpy_fn = memcpy;
+        q->handlers->move_fn = NULL;
+        q->handlers->swap_fn = NULL;
     }
-    if (q->handlers->malloc_fn)
-        q->data = q->handlers->malloc_fn(slots * data_size);
+    /* Fall back to malloc_fn if a mapping fails. */
+    if (q->options & (CXQ_OPT_MIRROR | CXQ_OPT_HUGEPAGE)) {
+        q->data = _cxq_body_alloc(q, slots);
+        if (!q->data)
+            q->options &= ~(CXQ_OPT_MIRROR | CXQ_OPT_HUGEPAGE);
+    }
+    if (!(q->options & (CXQ_OPT_MIRROR | CXQ_OPT_HUGEPAGE))
+        && q->handlers->malloc_fn)
+        q->data = _cxq_body_alloc(q, slots);
+    q->min_slots = slots;
+    q->max_slots = 0;
+    q->low_ops = 0;
     MUTEX_INIT(q->lock, NULL);
+    SEM_INIT(q->not_empty, CXQ_SEM_MAX, 0);
+    SEM_INIT(q->not_full, CXQ_SEM_MAX, 0);
+#ifdef MULTI_THREAD
+    q->rd_waiting = 0;
+    q->wr_waiting = 0;
+#endif
 }
 
 
@@ -61,37 +459,420 @@ void cxq_init(cxq_t *q, int slots, int data_size, memfuns_t *handlers) {
 */
 void cxq_finish(cxq_t *q) {
     MUTEX_DESTROY(q->lock);
-    if (q->handlers->free_fn)
-        q->handlers->free_fn(q->data);
+    SEM_DESTROY(q->not_empty);
+    SEM_DESTROY(q->not_full);
+    _cxq_body_free(q, q->data, q->slots);
+#ifdef __linux__
+    if (q->fd >= 0)
+        close(q->fd);
+    if (q->space_fd >= 0)
+        close(q->space_fd);
+#endif
+    free(q->stamps);
+    free(q->hist);
     free(q->handlers);
 }
 
 
+/* Round n up to the next power of two. */
+int cxq_pow2_roundup(int n) {
+    int p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+
+/* Wrap a position in 0..2*slots-1 back into 0..slots-1. */
+static inline int _cxq_wrap(const cxq_t *q, int pos) {
+    if (q->options & CXQ_OPT_POW2)
+        return pos & q->mask;
+    return pos % q->slots;
+}
+
+
+/* Address of slot `index`. */
+static inline void * _cxq_slot(const cxq_t *q, int index) {
+    return q->data + index * q->stride;
+}
+
+
+/*
+  SPSC helpers.  Positions run over 0..2*slots-1 so that a full queue
+  (tail - head == slots) and an empty one (tail == head) can be told
+  apart without a shared count.  With CXQ_OPT_POW2 they are free-running
+  and wrap naturally at UINT_MAX.
+*/
+static inline unsigned _spsc_next(const cxq_t *q, unsigned pos) {
+    if (q->options & CXQ_OPT_POW2)
+        return pos + 1;
+    return (pos + 1 == 2 * (unsigned)q->slots) ? 0 : pos + 1;
+}
+
+static inline unsigned _spsc_advance(const cxq_t *q, unsigned pos, int n) {
+    if (q->options & CXQ_OPT_POW2)
+        return pos + n;
+    pos += n;
+    return (pos >= 2 * (unsigned)q->slots) ? pos - 2 * q->slots : pos;
+}
+
+static inline int _spsc_index(const cxq_t *q, unsigned pos) {
+    if (q->options & CXQ_OPT_POW2)
+        return pos & q->mask;
+    return (pos < (unsigned)q->slots) ? pos : pos - q->slots;
+}
+
+static inline int _spsc_count(const cxq_t *q, unsigned head, unsigned tail) {
+    int n = (int)(tail - head);
+    if (q->options & CXQ_OPT_POW2)
+        return n;
+    return (n < 0) ? n + 2 * q->slots : n;
+}
+
+/* Someone waits for the empty to not empty edge, see _spsc_edge_added. */
+static inline bool _cxq_watched(const cxq_t *q) {
+    return q->fd >= 0 || q->notify_fn;
+}
+
+
+/*
+  Each side keeps a private copy of the other side's position and only
+  loads the shared one, pulling its cache line over, when the copy says
+  the queue is full (producer) or empty (consumer).  The copies lag, so
+  they only ever under-report room and data.
+*/
+static inline int _spsc_room(cxq_t *q, unsigned tail, int want) {
+    int room = q->slots - _spsc_count(q, q->head_cache, tail);
+    if (room < want) {
+        if (q->space_fd >= 0)
+            atomic_thread_fence(memory_order_seq_cst);
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        room = q->slots - _spsc_count(q, q->head_cache, tail);
+    }
+    return room;
+}
+
+static inline int _spsc_avail(cxq_t *q, unsigned head, int want) {
+    int avail = _spsc_count(q, head, q->tail_cache);
+    if (avail < want) {
+        if (_cxq_watched(q))
+            atomic_thread_fence(memory_order_seq_cst);
+        q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+        avail = _spsc_count(q, head, q->tail_cache);
+    }
+    return avail;
+}
+
+
+/*
+  Empty/full edges.  The eventfd and the cxq_watch callback only fire
+  when the queue goes from empty to not empty (or full to not full),
+  so a busy queue costs no syscalls.  In SPSC mode the side that
+  publishes a position and the side that finds the queue empty (or
+  full) each put a full fence between their store and their load of
+  the other position, so one of them always sees the other: either the
+  waiter finds the new element, or the publisher sees the queue was
+  empty and signals.
+*/
+static inline void _cxq_fd_signal(int fd) {
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t r = write(fd, &one, sizeof(one));
+    (void)r;    /* EAGAIN only if the count is already huge. */
+#endif
+}
+
+static inline void _cxq_signal_not_empty(cxq_t *q) {
+    if (q->fd >= 0)
+        _cxq_fd_signal(q->fd);
+    if (q->notify_fn)
+        q->notify_fn(q->notify_arg, q->notify_tag);
+}
+
+static inline void _cxq_edge_not_empty(cxq_t *q, int n) {
+    if (_cxq_watched(q) && n > 0 && q->count <= n)
+        _cxq_signal_not_empty(q);
+}
+
+static inline void _cxq_edge_not_full(cxq_t *q, int n) {
+    if (q->space_fd >= 0 && n > 0 && q->count + q->reserved + n >= q->slots)
+        _cxq_fd_signal(q->space_fd);
+}
+
+/* SPSC producer, after publishing n elements up to `tail`. */
+static inline void _spsc_edge_added(cxq_t *q, unsigned tail, int n) {
+    if (!_cxq_watched(q) || n <= 0)
+        return;
+    atomic_thread_fence(memory_order_seq_cst);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (_spsc_count(q, head, tail) <= n)
+        _cxq_signal_not_empty(q);
+}
+
+/* SPSC consumer, after releasing n elements up to `head`. */
+static inline void _spsc_edge_removed(cxq_t *q, unsigned head, int n) {
+    if (q->space_fd < 0 || n <= 0)
+        return;
+    atomic_thread_fence(memory_order_seq_cst);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (_spsc_count(q, head, tail) + n >= q->slots)
+        _cxq_fd_signal(q->space_fd);
+}
+
+
+/* Returns true if there's no room for another element, counting a slot
+   handed out by cxq_reserve.  Lock must be held. */
+static inline bool _cxq_full(const cxq_t *q) {
+    return q->count + q->reserved >= q->slots;
+}
+
+
+/* In circular mode, make room by dropping the oldest element, unless
+   it's held by cxq_peek.  Lock must be held. */
+static void _cxq_overwrite(cxq_t *q) {
+    if (q->circular && _cxq_full(q) && !q->held) {
+        q->first = _cxq_wrap(q, q->first + 1);
+        q->count--;
+        STAT_ADD(q, overwritten, 1);
+    }
+}
+
+
+/* Count n elements added.  Lock must be held. */
+static inline void _cxq_stat_added(cxq_t *q, int n) {
+#ifdef CXQ_STATS
+    q->stats.enqueued += n;
+    if (q->count > q->stats.high_water)
+        q->stats.high_water = q->count;
+#else
+    (void)q;
+    (void)n;
+#endif
+}
+
+
+/* Count n elements added by the SPSC producer, up to position tail. */
+static inline void _spsc_stat_added(cxq_t *q, int n, unsigned tail) {
+#ifdef CXQ_STATS
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    int count = _spsc_count(q, head, tail);
+    q->stats.enqueued += n;
+    if (count > q->stats.high_water)
+        q->stats.high_water = count;
+#else
+    (void)q;
+    (void)n;
+    (void)tail;
+#endif
+}
+
+
+/* Count n elements removed by the SPSC consumer. */
+static inline void _spsc_stat_removed(cxq_t *q, int n) {
+#ifdef CXQ_STATS
+    q->dequeued += n;
+#else
+    (void)q;
+    (void)n;
+#endif
+}
+
+
+/* CXQ_OPT_TIMESTAMP: stamp n slots from index `first` as enqueued now. */
+static inline void _cxq_stamp(cxq_t *q, int first, int n) {
+    if (!q->stamps)
+        return;
+    uint64_t now = CXQ_NOW_NS();
+    for (int i = 0; i < n; i++)
+        q->stamps[_cxq_wrap(q, first + i)] = now;
+}
+
+
+/* Histogram bucket for a residence time of ns nanoseconds. */
+static inline int _cxq_hist_bucket(uint64_t ns) {
+    int b = 0;
+#ifdef __GNUC__
+    if (ns)
+        b = 63 - __builtin_clzll(ns);
+#else
+    while (ns >>= 1)
+        b++;
+#endif
+    return (b < CXQ_HIST_BUCKETS) ? b : CXQ_HIST_BUCKETS - 1;
+}
+
+
+/* CXQ_OPT_TIMESTAMP: record how long n slots from index `first` spent
+   in the queue.  Lock must be held, or called by the SPSC consumer. */
+static inline void _cxq_residence(cxq_t *q, int first, int n) {
+    if (!q->stamps)
+        return;
+    uint64_t now = CXQ_NOW_NS();
+    cxq_hist_t *h = q->hist;
+    for (int i = 0; i < n; i++) {
+        uint64_t ns = now - q->stamps[_cxq_wrap(q, first + i)];
+        h->count[_cxq_hist_bucket(ns)]++;
+        h->total++;
+        h->sum_ns += ns;
+        if (ns > h->max_ns)
+            h->max_ns = ns;
+    }
+}
+
+
+/*
+  Description
+    Move the queue to a new body of `slots` slots, unrolling the
+    elements to start at slot 0.  Elements are relocated bitwise, the
+    way realloc would, not through memcpy_fn.  Lock must be held.
+
+  Returns
+    true on success.  On failure the queue is unchanged.
+*/
+static bool _cxq_resize(cxq_t *q, int slots) {
+    void *data = _cxq_body_alloc(q, slots);
+    uint64_t *stamps = NULL;
+    if (!data)
+        return false;
+    if (q->stamps) {
+        stamps = malloc(slots * sizeof(stamps[0]));
+        if (!stamps) {
+            _cxq_body_free(q, data, slots);
+            return false;
+        }
+    }
+    int run = (q->count < q->slots - q->first) ? q->count
+                                                : q->slots - q->first;
+    memcpy(data, _cxq_slot(q, q->first), (size_t)run * q->stride);
+    memcpy(data + run * q->stride, q->data,
+           (size_t)(q->count - run) * q->stride);
+    if (stamps) {
+        memcpy(stamps, q->stamps + q->first, run * sizeof(stamps[0]));
+        memcpy(stamps + run, q->stamps, (q->count - run) * sizeof(stamps[0]));
+        free(q->stamps);
+        q->stamps = stamps;
+    }
+    _cxq_body_free(q, q->data, q->slots);
+    q->data = data;
+    q->first = 0;
+    q->slots = slots;
+    q->mask = slots - 1;
+    q->low_ops = 0;
+    return true;
+}
+
+
+/* Growable queues: before adding `need` elements, double the body
+   until they fit, up to max_slots, or halve it once the queue has
+   stayed under a quarter full for `slots` enqueues in a row.  Nothing
+   moves while a slot is reserved or held.  Lock must be held. */
+static void _cxq_autosize(cxq_t *q, int need) {
+    if (!q->max_slots || q->circular || q->reserved || q->held)
+        return;
+    int want = q->count + need;
+    if (want > q->slots && q->slots < q->max_slots) {
+        int slots = q->slots;
+        while (slots < want && slots < q->max_slots)
+            slots = (slots > q->max_slots / 2) ? q->max_slots : slots * 2;
+        _cxq_resize(q, slots);
+    } else if (q->slots > q->min_slots && want <= q->slots / 4) {
+        if (++q->low_ops >= q->slots) {
+            int slots = q->slots / 2;
+            _cxq_resize(q, (slots > q->min_slots) ? slots : q->min_slots);
+        }
+    } else {
+        q->low_ops = 0;
+    }
+}
+
+
 /* Returns true if queue is a ring buffer, otherwise false. */
 bool cxq_get_circular(const cxq_t *q) {return q->circular;}
 
 
 /* Make queue a ring buffer. */
-void cxq_set_circular(cxq_t *q) {q->circular = true;}
+void cxq_set_circular(cxq_t *q) {
+    if (!(q->options & CXQ_OPT_SPSC))
+        q->circular = true;
+}
+
+
+/*
+  Description
+    Let the queue grow instead of failing when it's full.  An enqueue
+    that finds no room doubles the body, up to `max_slots`, unrolling
+    the elements into the new one, so enqueue stays amortized O(1).
+    Once the queue has stayed under a quarter full for as many enqueues
+    as it has slots, the body is halved again, never below the slots
+    given at init.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    max_slots  - Cap on the number of slots, or 0 to make the queue
+                 fixed size again.  With CXQ_OPT_POW2 or CXQ_OPT_MIRROR
+                 it's rounded up so the body only ever doubles.
+
+  Returns
+    None
+
+  Note
+    Ignored in circular and CXQ_OPT_SPSC mode.  The body is allocated
+    with malloc_fn each time, so queues without one, such as those from
+    cxq_init_arena, stay fixed size.  A pointer returned by
+    cxq_enqueue or cxq_dequeue(q, NULL, ...) is only valid until the
+    next enqueue; cxq_reserve and cxq_peek slots are never moved.
+*/
+void cxq_set_growth(cxq_t *q, int max_slots) {
+    if (q->circular || (q->options & CXQ_OPT_SPSC))
+        return;
+    LOCK(q->lock);
+    if (max_slots > 0 && max_slots < q->min_slots)
+        max_slots = q->min_slots;
+    if (max_slots > 0 && (q->options & (CXQ_OPT_POW2 | CXQ_OPT_MIRROR))) {
+        int cap = q->min_slots;
+        while (cap < max_slots)
+            cap *= 2;
+        max_slots = cap;
+    }
+    q->max_slots = max_slots;
+    q->low_ops = 0;
+    UNLOCK(q->lock);
+}
 
 
 /* Get position of first element in queue. */
-int cxq_get_first(const cxq_t *q) {return q->first;}
+int cxq_get_first(const cxq_t *q) {
+    if (q->options & CXQ_OPT_SPSC)
+        return _spsc_index(q, atomic_load_explicit(&q->head,
+                                                   memory_order_acquire));
+    return q->first;
+}
 
 
 /* Set starting position for queue. */
 void cxq_set_first(cxq_t *q, int first) {
+    if (q->options & CXQ_OPT_SPSC)
+        return;
     if (q->first < q->slots)
         q->first = first;
 }
 
 
 /* Get position of last element in queue. */
-int cxq_get_last(const cxq_t *q) {return (q->first + q->count - 1) % q->slots;}
+int cxq_get_last(const cxq_t *q) {
+    return _cxq_wrap(q, cxq_get_first(q) + cxq_get_count(q) - 1);
+}
 
 
 /* Returns num of elements in queue. */
-int cxq_get_count(const cxq_t *q) {return q->count;}
+int cxq_get_count(const cxq_t *q) {
+    if (q->options & CXQ_OPT_SPSC) {
+        unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+        unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+        return _spsc_count(q, head, tail);
+    }
+    return q->count;
+}
 
 
 /* Returns number of data slots. */
@@ -102,6 +883,61 @@ int cxq_get_slots(const cxq_t *q) {return q->slots;}
 int cxq_get_data_size(const cxq_t *q) {return q->data_size;}
 
 
+/*
+  Description
+    Get the eventfd that CXQ_OPT_EVENTFD signals when the queue goes
+    from empty to not empty, to wait for data in an epoll/poll loop
+    instead of inside a queue call.  It's non-blocking and becomes
+    readable on that edge only, not for every element.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+
+  Returns
+    The fd, or -1 if the queue was made without CXQ_OPT_EVENTFD.
+
+  Note
+    When the fd is readable, read its 8-byte counter to clear it first,
+    then dequeue until the queue is empty.  Stopping with elements left
+    in the queue means no further signal until it has been emptied.
+*/
+int cxq_get_fd(const cxq_t *q) {return q->fd;}
+
+
+/* Same as cxq_get_fd, for the CXQ_OPT_EVENTFD_SPACE fd that signals
+   producers when the queue goes from full to not full. */
+int cxq_get_space_fd(const cxq_t *q) {return q->space_fd;}
+
+
+/*
+  Description
+    Have `fn(arg, tag)` called each time the queue goes from empty to
+    not empty, the same edge that signals the CXQ_OPT_EVENTFD fd.  It's
+    how cxq_set_t learns which of its queues have data.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    fn         - Callback, or NULL to stop watching.
+    arg        - Passed to fn.
+    tag        - Passed to fn, e.g. to tell queues apart.
+
+  Returns
+    None
+
+  Note
+    fn runs in the producer, with the queue lock held unless in
+    CXQ_OPT_SPSC mode, so it must be short and must not call back into
+    the queue.  In SPSC mode set it before the producer starts.
+*/
+void cxq_watch(cxq_t *q, cxq_notify_t fn, void *arg, int tag) {
+    LOCK(q->lock);
+    q->notify_arg = arg;
+    q->notify_tag = tag;
+    q->notify_fn = fn;
+    UNLOCK(q->lock);
+}
+
+
 /*
   Description
     Retrieve an element from end of queue, optionally remove from queue.
@@ -123,19 +959,47 @@ int cxq_get_data_size(const cxq_t *q) {return q->data_size;}
   Note
     In the case when `data` is set to NULL by the caller and
     `remove` is set to true, `data` will be valid until
-    it's overwritten.
+    it's overwritten.  Use cxq_peek/cxq_release when the pointer
+    must stay valid.
+
+    While an element is held by cxq_peek, it can't be removed, and
+    NULL is returned if `remove` is true.
 */
 static void * _cxq_dequeue(cxq_t *q, void *data, bool remove) {
     void * slot;
-    if (q->count <= 0) {
-        /* No data. */
+    if (q->count <= 0 || (remove && q->held)) {
+        /* No data, or first element is held by cxq_peek. */
         slot = NULL;
     } else {
-        slot = q->data + q->first * q->data_size;
+        slot = _cxq_slot(q, q->first);
         if (data) q->handlers->memcpy_fn(data, slot, q->data_size);
         if (remove) {
-            q->first = (q->first + 1) % q->slots;
+            _cxq_residence(q, q->first, 1);
+            q->first = _cxq_wrap(q, q->first + 1);
             q->count--;
+            STAT_ADD(q, dequeued, 1);
+        }
+    }
+    return slot;
+}
+
+
+/* Same as _cxq_dequeue, for CXQ_OPT_SPSC queues.  Consumer only. */
+static void * _cxq_spsc_dequeue(cxq_t *q, void *data, bool remove) {
+    void * slot;
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (_spsc_avail(q, head, 1) < 1) {
+        /* No data. */
+        slot = NULL;
+    } else {
+        slot = _cxq_slot(q, _spsc_index(q, head));
+        if (data) q->handlers->memcpy_fn(data, slot, q->data_size);
+        if (remove) {
+            _cxq_residence(q, _spsc_index(q, head), 1);
+            head = _spsc_next(q, head);
+            atomic_store_explicit(&q->head, head, memory_order_release);
+            _spsc_stat_removed(q, 1);
+            _spsc_edge_removed(q, head, 1);
         }
     }
     return slot;
@@ -145,8 +1009,12 @@ static void * _cxq_dequeue(cxq_t *q, void *data, bool remove) {
 /* Public wrapper for _cxq_dequeue. */
 void * cxq_dequeue(cxq_t *q, void *data, bool remove) {
     void * slot;
-    LOCK(q->lock);
+    if (q->options & CXQ_OPT_SPSC)
+        return _cxq_spsc_dequeue(q, data, remove);
+    QLOCK(q);
     slot = _cxq_dequeue(q, data, remove);
+    if (slot && remove)
+        WAKE_ONE(q, wr_waiting, not_full);
     UNLOCK(q->lock);
     return slot;
 }
@@ -163,19 +1031,45 @@ void * cxq_dequeue(cxq_t *q, void *data, bool remove) {
 
   Returns
     slot - A pointer to the enqueued data element.  Returns NULL
-    if there are no open slots available, i.e. queue is full.
+    if there are no open slots available, i.e. queue is full, or
+    if the next slot is reserved by cxq_reserve.
 */
 static void * _cxq_enqueue(cxq_t *q, const void *data) {
     void * slot;
-    if (q->count >= q->slots) {
+    _cxq_autosize(q, 1);
+    if (q->count >= q->slots || q->reserved) {
         /* No buffer space available. */
         slot = NULL;
     } else {
-        int next = (q->first + q->count) % q->slots;
-        slot = q->data + next * q->data_size;
+        int next = _cxq_wrap(q, q->first + q->count);
+        slot = _cxq_slot(q, next);
         if (q->handlers->memcpy_fn)
             q->handlers->memcpy_fn(slot, data, q->data_size);
+        _cxq_stamp(q, next, 1);
         q->count++;
+        _cxq_stat_added(q, 1);
+    }
+    return slot;
+}
+
+
+/* Same as _cxq_enqueue, for CXQ_OPT_SPSC queues.  Producer only. */
+static void * _cxq_spsc_enqueue(cxq_t *q, const void *data) {
+    void * slot;
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (_spsc_room(q, tail, 1) < 1) {
+        /* No buffer space available. */
+        slot = NULL;
+        STAT_ADD(q, rejected, 1);
+    } else {
+        slot = _cxq_slot(q, _spsc_index(q, tail));
+        if (q->handlers->memcpy_fn)
+            q->handlers->memcpy_fn(slot, data, q->data_size);
+        _cxq_stamp(q, _spsc_index(q, tail), 1);
+        tail = _spsc_next(q, tail);
+        atomic_store_explicit(&q->tail, tail, memory_order_release);
+        _spsc_stat_added(q, 1, tail);
+        _spsc_edge_added(q, tail, 1);
     }
     return slot;
 }
@@ -184,28 +1078,37 @@ static void * _cxq_enqueue(cxq_t *q, const void *data) {
 /* Public wrapper for _cxq_enqueue. */
 void * cxq_enqueue(cxq_t *q, const void *data) {
     void * slot;
-    LOCK(q->lock);
-    if (q->circular && cxq_isfull(q))
-        _cxq_dequeue(q, NULL, true);
+    if (q->options & CXQ_OPT_SPSC)
+        return _cxq_spsc_enqueue(q, data);
+    QLOCK(q);
+    _cxq_overwrite(q);
     slot = _cxq_enqueue(q, data);
+    if (slot)
+        WAKE_ONE(q, rd_waiting, not_empty);
+    else
+        STAT_ADD(q, rejected, 1);
     UNLOCK(q->lock);
     return slot;
 }
 
 
 /* Same as _cxq_enqueue, except element to front of queue
-   User code must not call this function directly.
+   User code must not call this function directly.  Fails while the
+   first element is held by cxq_peek.
 */
 static void * _cxq_enqueue_front(cxq_t *q, const void *data) {
     void * slot;
-    if (q->count >= q->slots) {
+    _cxq_autosize(q, 1);
+    if (_cxq_full(q) || q->held) {
         /* No buffer space available. */
         slot = NULL;
     } else {
         q->first = q->first ? q->first - 1 : q->slots - 1;
-        slot = q->data + q->first * q->data_size;
+        slot = _cxq_slot(q, q->first);
         q->handlers->memcpy_fn(slot, data, q->data_size);
+        _cxq_stamp(q, q->first, 1);
         q->count++;
+        _cxq_stat_added(q, 1);
     }
     return slot;
 }
@@ -214,36 +1117,820 @@ static void * _cxq_enqueue_front(cxq_t *q, const void *data) {
 /* Public wrapper for _enqueue_front. */
 void * cxq_enqueue_front(cxq_t *q, const void *data) {
     void * slot;
-    LOCK(q->lock);
-    if (q->circular && cxq_isfull(q))
-        _cxq_dequeue(q, NULL, true);
+    if (q->options & CXQ_OPT_SPSC)
+        return NULL;
+    QLOCK(q);
+    _cxq_overwrite(q);
     slot = _cxq_enqueue_front(q, data);
+    if (slot)
+        WAKE_ONE(q, rd_waiting, not_empty);
+    else
+        STAT_ADD(q, rejected, 1);
     UNLOCK(q->lock);
     return slot;
 }
 
 
-/* Remove all elements from queue. */
-void cxq_flush(cxq_t *q) {
-    while (!cxq_isempty(q))
-        cxq_dequeue(q, NULL, true);
-}
-
+/*
+  Description
+    Same as cxq_enqueue, but if the queue is full, wait for a consumer
+    to open a slot.  The call first polls CXQ_SPIN_COUNT times so short
+    waits stay cheap, then parks on the `not_full` semaphore so an idle
+    producer uses no CPU.
 
-/* Returns true if queue is empty. */
-bool cxq_isempty(const cxq_t *q) {return q->count <= 0;}
+  Parameters
+    q          - Pointer to cxq_t struct.
+    data       - Pointer to source memory for enqueued element.
+    timeout    - Max time to park in ms, or CXQ_WAIT_FOREVER.  A thread
+                 that is woken but loses the slot to another producer
+                 parks again with the full timeout.
+
+  Returns
+    slot - A pointer to the enqueued data element, or NULL on timeout.
+
+  Note
+    Without MULTI_THREAD, or in CXQ_OPT_SPSC mode, there is nothing to
+    park on, and the call returns NULL once polling fails.
+*/
+void * cxq_enqueue_wait(cxq_t *q, const void *data, uint32_t timeout) {
+    void * slot;
+    if (q->circular)
+        return cxq_enqueue(q, data);
+    for (int i = 0; i < CXQ_SPIN_COUNT; i++) {
+        if (!cxq_isfull(q) && (slot = cxq_enqueue(q, data)))
+            return slot;
+    }
+#ifdef MULTI_THREAD
+    if (q->options & CXQ_OPT_SPSC)
+        return cxq_enqueue(q, data);
+    QLOCK(q);
+    while (!(slot = _cxq_enqueue(q, data))) {
+        q->wr_waiting++;
+        UNLOCK(q->lock);
+        int timed_out = SEM_WAIT(q->not_full, timeout);
+        QLOCK(q);
+        if (timed_out) {
+            /* Withdraw, unless a consumer posted for us meanwhile. */
+            if (SEM_WAIT(q->not_full, 0))
+                q->wr_waiting--;
+            slot = _cxq_enqueue(q, data);
+            break;
+        }
+    }
+    if (slot)
+        WAKE_ONE(q, rd_waiting, not_empty);
+    else
+        STAT_ADD(q, rejected, 1);
+    UNLOCK(q->lock);
+#else
+    (void)timeout;
+    slot = cxq_enqueue(q, data);
+#endif
+    return slot;
+}
+
+
+/*
+  Description
+    Same as cxq_dequeue(q, data, true), but if the queue is empty, wait
+    for a producer to add an element.  Polls CXQ_SPIN_COUNT times, then
+    parks on the `not_empty` semaphore.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    data       - Pointer to destination memory for dequeued element,
+                 or NULL, same as cxq_dequeue.
+    timeout    - Max time to park in ms, or CXQ_WAIT_FOREVER.  A thread
+                 that is woken but loses the element to another consumer
+                 parks again with the full timeout.
+
+  Returns
+    slot - A pointer to the dequeued data element, or NULL on timeout.
+
+  Note
+    Without MULTI_THREAD, or in CXQ_OPT_SPSC mode, there is nothing to
+    park on, and the call returns NULL once polling fails.
+*/
+void * cxq_dequeue_wait(cxq_t *q, void *data, uint32_t timeout) {
+    void * slot;
+    for (int i = 0; i < CXQ_SPIN_COUNT; i++) {
+        if (!cxq_isempty(q) && (slot = cxq_dequeue(q, data, true)))
+            return slot;
+    }
+#ifdef MULTI_THREAD
+    if (q->options & CXQ_OPT_SPSC)
+        return cxq_dequeue(q, data, true);
+    QLOCK(q);
+    while (!(slot = _cxq_dequeue(q, data, true))) {
+        q->rd_waiting++;
+        UNLOCK(q->lock);
+        int timed_out = SEM_WAIT(q->not_empty, timeout);
+        QLOCK(q);
+        if (timed_out) {
+            /* Withdraw, unless a producer posted for us meanwhile. */
+            if (SEM_WAIT(q->not_empty, 0))
+                q->rd_waiting--;
+            slot = _cxq_dequeue(q, data, true);
+            break;
+        }
+    }
+    if (slot)
+        WAKE_ONE(q, wr_waiting, not_full);
+    UNLOCK(q->lock);
+#else
+    (void)timeout;
+    slot = cxq_dequeue(q, data, true);
+#endif
+    return slot;
+}
+
+
+/* Elements that can be copied in one run from slot `start`, up to n.
+   With CXQ_OPT_MIRROR that is all of them. */
+static int _cxq_run(const cxq_t *q, int start, int n) {
+    if (q->options & CXQ_OPT_MIRROR)
+        return n;
+    return (n < q->slots - start) ? n : q->slots - start;
+}
+
+
+/*
+  Description
+    Copy `n` consecutive elements between a run of slots and user memory,
+    stepping `dstep` bytes through `dest` and `sstep` through `src`.
+    The built-in memcpy moves the whole run at once when the slots are
+    packed.  A custom memcpy_fn may deep copy nested members, so it is
+    called once per element.
+*/
+static void _cxq_copy_run(const cxq_t *q, void *dest, int dstep,
+                          const void *src, int sstep, int n) {
+    if (n <= 0)
+        return;
+    if (q->handlers->memcpy_fn == memcpy && dstep == sstep) {
+        memcpy(dest, src, (size_t)n * q->data_size);
+        return;
+    }
+    for (int i = 0; i < n; i++)
+        q->handlers->memcpy_fn(dest + i * dstep, src + i * sstep,
+                               q->data_size);
+}
+
+
+/* Same as _cxq_enqueue, but for up to n elements.  Returns num added. */
+static int _cxq_enqueue_n(cxq_t *q, const void *src, int n) {
+    if (q->reserved) {
+        STAT_ADD(q, rejected, n);
+        return 0;
+    }
+    _cxq_autosize(q, n);
+    if (q->circular && !q->held) {
+        /* Only the newest `slots` elements survive; drop the oldest. */
+        if (n > q->slots) {
+            STAT_ADD(q, overwritten, n - q->slots);
+            src += (n - q->slots) * q->data_size;
+            n = q->slots;
+        }
+        int drop = n - (q->slots - q->count);
+        if (drop > 0) {
+            q->first = _cxq_wrap(q, q->first + drop);
+            q->count -= drop;
+            STAT_ADD(q, overwritten, drop);
+        }
+    } else if (n > q->slots - q->count) {
+        STAT_ADD(q, rejected, n - (q->slots - q->count));
+        n = q->slots - q->count;
+    }
+    int next = _cxq_wrap(q, q->first + q->count);
+    int run = _cxq_run(q, next, n);
+    if (q->handlers->memcpy_fn) {
+        _cxq_copy_run(q, _cxq_slot(q, next), q->stride,
+                      src, q->data_size, run);
+        _cxq_copy_run(q, q->data, q->stride,
+                      src + run * q->data_size, q->data_size, n - run);
+    }
+    _cxq_stamp(q, next, n);
+    q->count += n;
+    _cxq_stat_added(q, n);
+    return n;
+}
+
+
+/* Same as _cxq_enqueue_n, for CXQ_OPT_SPSC queues.  Producer only. */
+static int _cxq_spsc_enqueue_n(cxq_t *q, const void *src, int n) {
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    int room = _spsc_room(q, tail, n);
+    if (n > room) {
+        STAT_ADD(q, rejected, n - room);
+        n = room;
+    }
+    int next = _spsc_index(q, tail);
+    int run = _cxq_run(q, next, n);
+    if (q->handlers->memcpy_fn) {
+        _cxq_copy_run(q, _cxq_slot(q, next), q->stride,
+                      src, q->data_size, run);
+        _cxq_copy_run(q, q->data, q->stride,
+                      src + run * q->data_size, q->data_size, n - run);
+    }
+    _cxq_stamp(q, next, n);
+    tail = _spsc_advance(q, tail, n);
+    atomic_store_explicit(&q->tail, tail, memory_order_release);
+    _spsc_stat_added(q, n, tail);
+    _spsc_edge_added(q, tail, n);
+    return n;
+}
+
+
+/*
+  Description
+    Add up to `n` elements to end of queue, taking the lock once.  The
+    elements are copied in at most two runs, split where the ring wraps.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    src        - Pointer to an array of `n` source elements.
+    n          - Number of elements to add.  0 or less adds none.
+
+  Returns
+    Number of elements added.  Less than `n` if the queue fills up.
+    In circular mode the oldest elements are overwritten instead, and
+    if `n` exceeds `slots`, only the last `slots` elements of `src`
+    are kept.
+*/
+int cxq_enqueue_n(cxq_t *q, const void *src, int n) {
+    if (n <= 0)
+        return 0;
+    if (q->options & CXQ_OPT_SPSC)
+        return _cxq_spsc_enqueue_n(q, src, n);
+    QLOCK(q);
+    n = _cxq_enqueue_n(q, src, n);
+    WAKE_N(q, rd_waiting, not_empty, n);
+    UNLOCK(q->lock);
+    return n;
+}
+
+
+/* Same as _cxq_dequeue, but for up to n elements.  Returns num taken. */
+static int _cxq_dequeue_n(cxq_t *q, void *dst, int n, bool remove) {
+    if (remove && q->held)
+        return 0;
+    if (n > q->count)
+        n = q->count;
+    int run = _cxq_run(q, q->first, n);
+    if (dst) {
+        _cxq_copy_run(q, dst, q->data_size,
+                      _cxq_slot(q, q->first), q->stride, run);
+        _cxq_copy_run(q, dst + run * q->data_size, q->data_size,
+                      q->data, q->stride, n - run);
+    }
+    if (remove) {
+        _cxq_residence(q, q->first, n);
+        q->first = _cxq_wrap(q, q->first + n);
+        q->count -= n;
+        STAT_ADD(q, dequeued, n);
+    }
+    return n;
+}
+
+
+/* Same as _cxq_dequeue_n, for CXQ_OPT_SPSC queues.  Consumer only. */
+static int _cxq_spsc_dequeue_n(cxq_t *q, void *dst, int n, bool remove) {
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    int count = _spsc_avail(q, head, n);
+    if (n > count)
+        n = count;
+    int first = _spsc_index(q, head);
+    int run = _cxq_run(q, first, n);
+    if (dst) {
+        _cxq_copy_run(q, dst, q->data_size,
+                      _cxq_slot(q, first), q->stride, run);
+        _cxq_copy_run(q, dst + run * q->data_size, q->data_size,
+                      q->data, q->stride, n - run);
+    }
+    if (remove) {
+        _cxq_residence(q, first, n);
+        head = _spsc_advance(q, head, n);
+        atomic_store_explicit(&q->head, head, memory_order_release);
+        _spsc_stat_removed(q, n);
+        _spsc_edge_removed(q, head, n);
+    }
+    return n;
+}
+
+
+/*
+  Description
+    Retrieve up to `n` elements from front of queue, taking the lock
+    once, and optionally remove them.  The elements are copied out in
+    at most two runs, split where the ring wraps.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    dst        - Pointer to an array with room for `n` elements, or NULL
+                 to discard them.
+    n          - Max number of elements to retrieve.  0 or less takes
+                 none.
+    remove     - true to remove the elements from the queue.
+
+  Returns
+    Number of elements retrieved.
+*/
+int cxq_dequeue_n(cxq_t *q, void *dst, int n, bool remove) {
+    if (n <= 0)
+        return 0;
+    if (q->options & CXQ_OPT_SPSC)
+        return _cxq_spsc_dequeue_n(q, dst, n, remove);
+    QLOCK(q);
+    n = _cxq_dequeue_n(q, dst, n, remove);
+    if (remove)
+        WAKE_N(q, wr_waiting, not_full, n);
+    UNLOCK(q->lock);
+    return n;
+}
+
+
+/*
+  Description
+    Remove all elements from queue.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+
+  Returns
+    None
+
+  Note
+    An element held by cxq_peek stays until cxq_release.  If a slot is
+    also reserved, nothing is removed: the held element and the reserved
+    slot, at `first` and `first + count`, can only both stay put if the
+    elements between them do too.
+*/
+void cxq_flush(cxq_t *q) {
+    if (q->options & CXQ_OPT_SPSC) {
+        unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+        atomic_store_explicit(&q->head, q->tail_cache, memory_order_release);
+        _spsc_edge_removed(q, q->tail_cache,
+                           _spsc_count(q, head, q->tail_cache));
+        return;
+    }
+    QLOCK(q);
+    int n = q->count - q->held;
+    if (q->held && q->reserved)
+        n = 0;
+    else if (q->held)
+        q->count = 1;
+    else {
+        q->first = _cxq_wrap(q, q->first + n);
+        q->count = 0;
+    }
+    WAKE_N(q, wr_waiting, not_full, n);
+    UNLOCK(q->lock);
+}
+
+
+/*
+  Description
+    Exchange the contents of two elements with swap_fn, or byte by byte
+    if there's none.  A byte swap of a struct trades its pointer members,
+    so nested buffers change owner without being copied.
+*/
+static void _cxq_swap(const cxq_t *q, void *a, void *b) {
+    if (q->handlers->swap_fn) {
+        q->handlers->swap_fn(a, b, q->data_size);
+        return;
+    }
+    unsigned char *x = a, *y = b;
+    for (int i = 0; i < q->data_size; i++) {
+        unsigned char t = x[i];
+        x[i] = y[i];
+        y[i] = t;
+    }
+}
+
+
+/* Move element `src` into `dest` with move_fn.  Without one, swap;
+   a swap is a valid move. */
+static void _cxq_move(const cxq_t *q, void *dest, void *src) {
+    if (q->handlers->move_fn)
+        q->handlers->move_fn(dest, src, q->data_size);
+    else
+        _cxq_swap(q, dest, src);
+}
+
+
+/* Same as cxq_enqueue, but moves or swaps `data` into the slot instead
+   of copying it. */
+static void * _cxq_enqueue_xfer(cxq_t *q, void *data, bool swap) {
+    void * slot;
+    if (q->options & CXQ_OPT_SPSC) {
+        slot = cxq_reserve(q);
+        if (slot) {
+            if (swap) _cxq_swap(q, slot, data);
+            else _cxq_move(q, slot, data);
+            cxq_commit(q);
+        }
+        return slot;
+    }
+    QLOCK(q);
+    _cxq_overwrite(q);
+    _cxq_autosize(q, 1);
+    if (_cxq_full(q) || q->reserved) {
+        /* No buffer space available. */
+        slot = NULL;
+        STAT_ADD(q, rejected, 1);
+    } else {
+        int next = _cxq_wrap(q, q->first + q->count);
+        slot = _cxq_slot(q, next);
+        if (swap) _cxq_swap(q, slot, data);
+        else _cxq_move(q, slot, data);
+        _cxq_stamp(q, next, 1);
+        q->count++;
+        _cxq_stat_added(q, 1);
+        WAKE_ONE(q, rd_waiting, not_empty);
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/* Same as cxq_dequeue(q, data, true), but moves or swaps the slot into
+   `data` instead of copying it. */
+static void * _cxq_dequeue_xfer(cxq_t *q, void *data, bool swap) {
+    void * slot;
+    if (q->options & CXQ_OPT_SPSC) {
+        slot = cxq_peek(q);
+        if (slot) {
+            if (swap) _cxq_swap(q, data, slot);
+            else _cxq_move(q, data, slot);
+            cxq_release(q);
+        }
+        return slot;
+    }
+    QLOCK(q);
+    if (q->count <= 0 || q->held) {
+        /* No data, or first element is held by cxq_peek. */
+        slot = NULL;
+    } else {
+        slot = _cxq_slot(q, q->first);
+        if (swap) _cxq_swap(q, data, slot);
+        else _cxq_move(q, data, slot);
+        _cxq_residence(q, q->first, 1);
+        q->first = _cxq_wrap(q, q->first + 1);
+        q->count--;
+        STAT_ADD(q, dequeued, 1);
+        WAKE_ONE(q, wr_waiting, not_full);
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/*
+  Description
+    Add an element to end of queue by swapping it with the slot, instead
+    of copying it with memcpy_fn.  For structs that own nested buffers,
+    the slot takes over the caller's buffers and the caller gets the
+    slot's spare ones back, so the cost doesn't depend on payload size
+    and no buffer is leaked or shared.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    data       - Pointer to element to hand over.  On return it holds
+                 the slot's previous contents.
+
+  Returns
+    slot - A pointer to the enqueued data element, or NULL if the queue
+    is full.
+*/
+void * cxq_enqueue_swap(cxq_t *q, void *data) {
+    return _cxq_enqueue_xfer(q, data, true);
+}
+
+
+/*
+  Description
+    Remove the first element by swapping it into `data`, instead of
+    copying it with memcpy_fn.  The slot keeps the caller's previous
+    buffers as spares for the next enqueue.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    data       - Pointer to destination element.  Its nested buffers
+                 must be valid, since they're handed to the queue.
+
+  Returns
+    slot - A pointer to the slot the element came from, or NULL if the
+    queue is empty.
+*/
+void * cxq_dequeue_swap(cxq_t *q, void *data) {
+    return _cxq_dequeue_xfer(q, data, true);
+}
+
+
+/*
+  Description
+    Same as cxq_enqueue_swap, but uses move_fn, which hands `data` over
+    to the slot without giving anything back.  move_fn must release
+    whatever the slot owned; `data` is left in a moved-from state.
+    Falls back to swap when there's no move_fn.
+*/
+void * cxq_enqueue_move(cxq_t *q, void *data) {
+    return _cxq_enqueue_xfer(q, data, false);
+}
+
+
+/* Same as cxq_dequeue_swap, but uses move_fn, see cxq_enqueue_move. */
+void * cxq_dequeue_move(cxq_t *q, void *data) {
+    return _cxq_dequeue_xfer(q, data, false);
+}
+
+
+/*
+  Description
+    Reserve the slot at end of queue so the producer can fill it in
+    place, then publish it with cxq_commit.  Saves the copy made by
+    cxq_enqueue.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+
+  Returns
+    slot - A pointer to the reserved slot, or NULL if the queue is full
+    or a slot is already reserved.  In circular mode the oldest element
+    is dropped to make room, unless it's held by cxq_peek.
+
+  Note
+    Only one slot can be reserved at a time.  Until cxq_commit,
+    cxq_enqueue, cxq_enqueue_n and cxq_reserve return NULL/0.  In
+    CXQ_OPT_SPSC mode the producer must not call cxq_enqueue between
+    cxq_reserve and cxq_commit.
+*/
+void * cxq_reserve(cxq_t *q) {
+    void * slot;
+    if (q->options & CXQ_OPT_SPSC) {
+        unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        if (_spsc_room(q, tail, 1) < 1) {
+            STAT_ADD(q, rejected, 1);
+            return NULL;
+        }
+        return _cxq_slot(q, _spsc_index(q, tail));
+    }
+    QLOCK(q);
+    if (!q->reserved) {
+        _cxq_overwrite(q);
+        _cxq_autosize(q, 1);
+    }
+    if (q->reserved || _cxq_full(q)) {
+        slot = NULL;
+        STAT_ADD(q, rejected, 1);
+    } else {
+        slot = _cxq_slot(q, _cxq_wrap(q, q->first + q->count));
+        q->reserved = true;
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/* Publish the slot returned by cxq_reserve as the last element. */
+void cxq_commit(cxq_t *q) {
+    if (q->options & CXQ_OPT_SPSC) {
+        unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        _cxq_stamp(q, _spsc_index(q, tail), 1);
+        tail = _spsc_next(q, tail);
+        atomic_store_explicit(&q->tail, tail, memory_order_release);
+        _spsc_stat_added(q, 1, tail);
+        _spsc_edge_added(q, tail, 1);
+        return;
+    }
+    QLOCK(q);
+    if (q->reserved) {
+        q->reserved = false;
+        _cxq_stamp(q, _cxq_wrap(q, q->first + q->count), 1);
+        q->count++;
+        _cxq_stat_added(q, 1);
+        WAKE_ONE(q, rd_waiting, not_empty);
+    }
+    UNLOCK(q->lock);
+}
+
+
+/*
+  Description
+    Get a pointer to the first element without copying it.  Unlike
+    cxq_dequeue(q, NULL, true), the element stays in the queue, and
+    the slot can't be overwritten, until cxq_release.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+
+  Returns
+    slot - A pointer to the first element, or NULL if the queue is
+    empty or an element is already held.
+
+  Note
+    Only one element can be held at a time.  Until cxq_release, calls
+    that would remove or overwrite it (cxq_dequeue and cxq_dequeue_n
+    with `remove`, cxq_enqueue_front, circular overwrite) fail instead.
+    cxq_flush keeps it, and flushes nothing while a slot is reserved.
+*/
+void * cxq_peek(cxq_t *q) {
+    void * slot;
+    if (q->options & CXQ_OPT_SPSC)
+        return _cxq_spsc_dequeue(q, NULL, false);
+    QLOCK(q);
+    if (q->held || q->count <= 0) {
+        slot = NULL;
+    } else {
+        slot = _cxq_slot(q, q->first);
+        q->held = true;
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/* Remove the element returned by cxq_peek from the queue.  Wakes a
+   parked writer, and a reader that parked because the head was held. */
+void cxq_release(cxq_t *q) {
+    if (q->options & CXQ_OPT_SPSC) {
+        _cxq_spsc_dequeue(q, NULL, true);
+        return;
+    }
+    QLOCK(q);
+    if (q->held) {
+        q->held = false;
+        _cxq_dequeue(q, NULL, true);
+        WAKE_ONE(q, wr_waiting, not_full);
+        if (q->count > 0)
+            WAKE_PARKED(q, rd_waiting, not_empty, 1);
+    }
+    UNLOCK(q->lock);
+}
+
+
+/*
+  Description
+    Get a pointer to the first element and the number of elements that
+    follow it contiguously in memory, without copying or removing them.
+    With CXQ_OPT_MIRROR that is every element in the queue, so the whole
+    queue can be handed to write(), fwrite() or a parser in one call.
+    Otherwise the span stops where the ring wraps.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    n          - Set to the number of elements in the span.
+
+  Returns
+    A pointer to the first element, or NULL if the queue is empty.
+
+  Note
+    Nothing is held: the span stays valid until its elements are removed,
+    e.g. by cxq_dequeue_n(q, NULL, *n, true), or overwritten in circular
+    mode.  Consumer only for CXQ_OPT_SPSC queues.
+*/
+void * cxq_peek_span(cxq_t *q, int *n) {
+    int first, count;
+    if (q->options & CXQ_OPT_SPSC) {
+        unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+        first = _spsc_index(q, head);
+        count = _spsc_count(q, head, tail);
+    } else {
+        QLOCK(q);
+        first = q->first;
+        count = q->count;
+        UNLOCK(q->lock);
+    }
+    *n = _cxq_run(q, first, count);
+    return (count > 0) ? _cxq_slot(q, first) : NULL;
+}
+
+
+/* Returns true if queue is empty. */
+bool cxq_isempty(const cxq_t *q) {return cxq_get_count(q) <= 0;}
 
 
 /* Returns true if queue is full. */
-bool cxq_isfull(const cxq_t *q) {return q->count >= q->slots;}
+bool cxq_isfull(const cxq_t *q) {return cxq_get_count(q) >= q->slots;}
 
 
 /* Returns num of empty slots. */
-int cxq_slots_empty(const cxq_t *q) {return q->slots - q->count;}
+int cxq_slots_empty(const cxq_t *q) {return q->slots - cxq_get_count(q);}
 
 
 /* Returns num of filled slots, same as cxq_get_count(). */
-int cxq_slots_filled(const cxq_t *q) {return q->count;}
+int cxq_slots_filled(const cxq_t *q) {return cxq_get_count(q);}
+
+
+/*
+  Description
+    Take a snapshot of the queue's counters.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    stats      - Pointer to cxq_stats_t struct to fill in.
+
+  Returns
+    None
+
+  Note
+    Without CXQ_STATS the counters are not kept and all read zero.  In
+    CXQ_OPT_SPSC mode there's no lock, so the producer's and consumer's
+    counters are each read as they stand, and lock_waits is always 0.
+*/
+void cxq_get_stats(cxq_t *q, cxq_stats_t *stats) {
+#ifdef CXQ_STATS
+    LOCK(q->lock);
+    *stats = q->stats;
+    if (q->options & CXQ_OPT_SPSC)
+        stats->dequeued = q->dequeued;
+    UNLOCK(q->lock);
+#else
+    (void)q;
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+
+/* Zero the counters.  The high-water mark restarts at the current count.
+   In CXQ_OPT_SPSC mode, call it while the queue is idle. */
+void cxq_reset_stats(cxq_t *q) {
+#ifdef CXQ_STATS
+    LOCK(q->lock);
+    memset(&q->stats, 0, sizeof(q->stats));
+    q->dequeued = 0;
+    q->stats.high_water = cxq_get_count(q);
+    UNLOCK(q->lock);
+#else
+    (void)q;
+#endif
+}
+
+
+/*
+  Description
+    Take a snapshot of the CXQ_OPT_TIMESTAMP residence time histogram.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    hist       - Pointer to cxq_hist_t struct to fill in.
+
+  Returns
+    None
+
+  Note
+    All zero if the queue was not set up with CXQ_OPT_TIMESTAMP.  In
+    CXQ_OPT_SPSC mode the consumer updates the histogram without a lock;
+    read it from the consumer thread for an exact snapshot.
+*/
+void cxq_get_hist(cxq_t *q, cxq_hist_t *hist) {
+    if (!q->hist) {
+        memset(hist, 0, sizeof(*hist));
+        return;
+    }
+    LOCK(q->lock);
+    *hist = *q->hist;
+    UNLOCK(q->lock);
+}
+
+
+/* Zero the residence time histogram. */
+void cxq_reset_hist(cxq_t *q) {
+    if (!q->hist)
+        return;
+    LOCK(q->lock);
+    memset(q->hist, 0, sizeof(*q->hist));
+    UNLOCK(q->lock);
+}
+
+
+/*
+  Description
+    Estimate a percentile of the residence times in `hist`.
+
+  Parameters
+    hist       - Pointer to a histogram from cxq_get_hist.
+    p          - Fraction, e.g. 0.99 for the 99th percentile.
+
+  Returns
+    The top of the bucket holding the percentile, in ns, so at most 2x
+    the true value, and never more than the max seen.  0 if empty.
+*/
+uint64_t cxq_hist_percentile(const cxq_hist_t *hist, double p) {
+    if (hist->total == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(p * (hist->total - 1));
+    uint64_t seen = 0;
+    for (int b = 0; b < CXQ_HIST_BUCKETS - 1; b++) {
+        seen += hist->count[b];
+        if (seen > rank) {
+            uint64_t top = ((uint64_t)2 << b) - 1;
+            return (top < hist->max_ns) ? top : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
 
 
 /*
@@ -258,12 +1945,106 @@ int cxq_slots_filled(const cxq_t *q) {return q->count;}
     None
 */
 void cxq_traverse(const cxq_t *q, cxq_callback_t peekfun) {
+    if (q->options & CXQ_OPT_SPSC) {
+        unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+        for (unsigned pos = head; pos != tail; pos = _spsc_next(q, pos))
+            peekfun(_cxq_slot(q, _spsc_index(q, pos)));
+        return;
+    }
     LOCK(q->lock);
     int index = q->first;
     for (int i = 0; i < q->count; i++) {
-        peekfun(q->data + index * q->data_size);
-        index = (index + 1) % q->slots;
+        peekfun(_cxq_slot(q, index));
+        index = _cxq_wrap(q, index + 1);
+    }
+    UNLOCK(q->lock);
+}
+
+
+/* Split the `count` elements from slot `first` into at most two
+   contiguous spans.  Returns the number of spans. */
+static int _cxq_spans(const cxq_t *q, int first, int count,
+                      cxq_span_t span[2]) {
+    if (count <= 0)
+        return 0;
+    int run = _cxq_run(q, first, count);
+    span[0].data = _cxq_slot(q, first);
+    span[0].n = run;
+    if (run == count)
+        return 1;
+    span[1].data = q->data;
+    span[1].n = count - run;
+    return 2;
+}
+
+
+/*
+  Description
+    Snapshot the elements in queue as at most two contiguous ranges,
+    split where the ring wraps.  The lock is only held to read the
+    indices.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    span       - Set to the ranges, oldest first.  Elements in a range
+                 are the queue's slot stride apart, data_size rounded up
+                 by CXQ_OPT_ALIGN.
+
+  Returns
+    Number of ranges, 0 if the queue is empty.  With CXQ_OPT_MIRROR it
+    is never more than 1.
+
+  Note
+    The ranges are not protected once the call returns.  Read them only
+    while nothing dequeues or overwrites those elements, e.g. with the
+    producers paused, or in SPSC mode from the consumer.
+*/
+int cxq_get_spans(const cxq_t *q, cxq_span_t span[2]) {
+    int first, count;
+    if (q->options & CXQ_OPT_SPSC) {
+        unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+        first = _spsc_index(q, head);
+        count = _spsc_count(q, head, tail);
+    } else {
+        LOCK(q->lock);
+        first = q->first;
+        count = q->count;
+        UNLOCK(q->lock);
     }
+    return _cxq_spans(q, first, count, span);
+}
+
+
+/*
+  Description
+    Same as cxq_traverse, but calls `fn` once per contiguous range of
+    elements instead of once per element: at most twice, split where
+    the ring wraps, and once with CXQ_OPT_MIRROR.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    fn         - Callback, given the first element of a range, the
+                 number of elements, the slot stride in bytes, and `arg`.
+    arg        - Passed to fn.
+
+  Returns
+    None
+*/
+void cxq_traverse_spans(const cxq_t *q, cxq_span_fn_t fn, void *arg) {
+    cxq_span_t span[2];
+    int spans;
+    if (q->options & CXQ_OPT_SPSC) {
+        spans = cxq_get_spans(q, span);
+        for (int i = 0; i < spans; i++)
+            fn(span[i].data, span[i].n, q->stride, arg);
+        return;
+    }
+    LOCK(q->lock);
+    spans = _cxq_spans(q, q->first, q->count, span);
+    for (int i = 0; i < spans; i++)
+        fn(span[i].data, span[i].n, q->stride, arg);
     UNLOCK(q->lock);
 }
 
@@ -332,6 +2113,12 @@ int main()
             printf("enqueue: %d\n", i);
     }
 
+    /* Peek at a batch of elements without removing them. */
+    int batch[4];
+    int n = cxq_dequeue_n(&q, batch, 4, false);
+    for (int i = 0; i < n; i++)
+        printf("dequeue_n: %d\n", batch[i]);
+
     /* Flush queue. */
     printf("before flush\n");
     printf("cxq_slots_filled = %d\n", cxq_slots_filled(&q));
@@ -339,6 +2126,21 @@ int main()
     printf("after flush\n");
     printf("cxq_slots_filled = %d\n", cxq_slots_filled(&q));
 
+    /* Flush with an element held and a slot reserved: the commit must
+       still land on the reserved slot, so nothing is flushed. */
+    for (int i = 10; i < 13; i++)
+        cxq_enqueue(&q, &i);
+    cxq_peek(&q);
+    int *slot = cxq_reserve(&q);
+    *slot = 99;
+    cxq_flush(&q);
+    cxq_commit(&q);
+    cxq_release(&q);
+    printf("held/reserved flush:");
+    while (cxq_dequeue(&q, &i, true))
+        printf(" %d", i);
+    printf(" (expect 11 12 99)\n");
+
     /* Deinitialize the queue. */
     cxq_finish(&q);
 }
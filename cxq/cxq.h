@@ -11,34 +11,95 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* The SPSC positions.  C++ can't use <stdatomic.h> before C++23, so it
+   sees std::atomic<unsigned>, which has the same size and layout. */
+#ifdef __cplusplus
+#include <atomic>
+typedef std::atomic<unsigned> cxq_atomic_uint;
+#else
+#include <stdatomic.h>
+typedef atomic_uint cxq_atomic_uint;
+#endif
+
 #define CXQ_VERSION "0.9.0"
 
 //#define MULTI_THREAD
+//#define CXQ_POSIX         /* MULTI_THREAD on pthreads instead of CMSIS-RTOS2. */
+//#define CXQ_CACHE_ALIGN   /* Keep SPSC producer and consumer state apart. */
+//#define CXQ_STATS         /* Per-queue counters, see cxq_get_stats. */
 
 #ifndef NOP
 #define NOP ((void) 0)
 #endif
 
+/* Timeout value for SEM_WAIT and the cxq_*_wait calls, in milliseconds. */
+#define CXQ_WAIT_FOREVER    0xFFFFFFFFU
+
+/* Number of times the cxq_*_wait calls poll before parking. */
+#ifndef CXQ_SPIN_COUNT
+#define CXQ_SPIN_COUNT      100
+#endif
+
+/* Cache line size, for padding and CXQ_OPT_ALIGN. */
+#ifndef CXQ_CACHE_LINE
+#define CXQ_CACHE_LINE      64
+#endif
+
+/* A cache line of padding in cxq_t when CXQ_CACHE_ALIGN is defined.
+   Padding rather than _Alignas keeps cxq_t at the alignment malloc
+   guarantees. */
+#ifdef CXQ_CACHE_ALIGN
+#define CXQ_PAD(name)       char name[CXQ_CACHE_LINE];
+#else
+#define CXQ_PAD(name)
+#endif
+
+/* Hugepage size for CXQ_OPT_HUGEPAGE. */
+#ifndef CXQ_HUGEPAGE_SIZE
+#define CXQ_HUGEPAGE_SIZE   (2 * 1024 * 1024)
+#endif
+
 /* Mutex helpers. */
-#ifdef MULTI_THREAD
+#if defined(MULTI_THREAD) && defined(CXQ_POSIX)
+#include <pthread.h>
+typedef pthread_mutex_t cxq_mutex_t;
+#define LOCK(mutex_id)              pthread_mutex_lock((cxq_mutex_t *)&(mutex_id))
+#define UNLOCK(mutex_id)            pthread_mutex_unlock((cxq_mutex_t *)&(mutex_id))
+#define TRYLOCK(mutex_id)           (pthread_mutex_trylock(&(mutex_id)) == 0)
+#define MUTEX_INIT(mutex_id, attr)  pthread_mutex_init(&(mutex_id), (attr))
+#define MUTEX_DESTROY(mutex_id)     pthread_mutex_destroy(&(mutex_id))
+#elif defined(MULTI_THREAD)
+typedef osMutexId_t cxq_mutex_t;
 #define LOCK(mutex_id)              osMutexAcquire((mutex_id), osWaitForever)
 #define UNLOCK(mutex_id)            osMutexRelease((mutex_id))
+#define TRYLOCK(mutex_id)           (osMutexAcquire((mutex_id), 0) == osOK)
 #define MUTEX_INIT(mutex_id, attr)  ((mutex_id) = osMutexNew((attr)))
-#define MUTEX_DESTROY(mutex_id)     osMutexRelease((mutex_id))
+#define MUTEX_DESTROY(mutex_id)     osMutexDelete((mutex_id))
 #else
 #define LOCK(mutex_id)              NOP
 #define UNLOCK(mutex_id)            NOP
+#define TRYLOCK(mutex_id)           true
 #define MUTEX_INIT(mutex_id, attr)  NOP
 #define MUTEX_DESTROY(mutex_id)     NOP
 #endif /* MULTI_THREAD */
 
-/* Semaphore helpers. */
-#ifdef MULTI_THREAD
+/* Semaphore helpers.  SEM_WAIT evaluates to 0 when the semaphore was
+   acquired, non-zero on timeout. */
+#if defined(MULTI_THREAD) && defined(CXQ_POSIX)
+#include <semaphore.h>
+typedef sem_t cxq_sem_t;
+int cxq_sem_wait(cxq_sem_t *sem, uint32_t timeout);
+#define SEM_WAIT(sem_id, timeout)   cxq_sem_wait(&(sem_id), (timeout))
+#define SEM_SIGNAL(sem_id)          sem_post(&(sem_id))
+#define SEM_INIT(sem_id, max, init) sem_init(&(sem_id), 0, (init))
+#define SEM_DESTROY(sem_id)         sem_destroy(&(sem_id))
+#elif defined(MULTI_THREAD)
+typedef osSemaphoreId_t cxq_sem_t;
 #define SEM_WAIT(sem_id, timeout)   osSemaphoreAcquire((sem_id), \
-            (timeout) == osWaitForever ? osWaitForever: portTICK_PERIOD_MS * (timeout))
+            (timeout) == osWaitForever ? osWaitForever: (timeout) / portTICK_PERIOD_MS)
 #define SEM_SIGNAL(sem_id)          osSemaphoreRelease((sem_id))
 #define SEM_INIT(sem_id, max, init) ((sem_id) = osSemaphoreNew((max), (init), NULL))
-#define SEM_DESTROY(sem_id)         osSemaphoreDelete((sem))
+#define SEM_DESTROY(sem_id)         osSemaphoreDelete((sem_id))
 #else
 #define SEM_WAIT(sem_id, timeout)   NOP
 #define SEM_SIGNAL(sem_id)          NOP
@@ -46,55 +107,176 @@
 #define SEM_DESTROY(sem_id)         NOP
 #endif /* MULTI_THREAD */
 
+/* Options for cxq_init_ex(), may be or'ed together. */
+#define CXQ_OPT_NONE    0x00
+#define CXQ_OPT_SPSC    0x01    /* Lock-free single producer/consumer. */
+#define CXQ_OPT_POW2    0x02    /* Round slots up to a power of two. */
+#define CXQ_OPT_MIRROR  0x04    /* Map the body twice, Linux only. */
+#define CXQ_OPT_HUGEPAGE 0x08   /* Back the body with hugepages, Linux only. */
+#define CXQ_OPT_TIMESTAMP 0x10  /* Time each element's stay, see cxq_get_hist. */
+#define CXQ_OPT_EVENTFD 0x20    /* Signal an eventfd when not empty, Linux only. */
+#define CXQ_OPT_EVENTFD_SPACE 0x40  /* Signal an eventfd when not full, Linux only. */
+#define CXQ_OPT_ALIGN(n) ((n) << 16)    /* Align body and slots to n bytes. */
+#define CXQ_OPT_CACHE_ALIGN CXQ_OPT_ALIGN(CXQ_CACHE_LINE)
+
 
 typedef struct {
     void * (*malloc_fn)(size_t size);
     void   (*free_fn)(void *ptr);
     void * (*memcpy_fn)(void *dest, const void *src, size_t n);
+    void   (*move_fn)(void *dest, void *src, size_t n);     /* Optional. */
+    void   (*swap_fn)(void *a, void *b, size_t n);          /* Optional. */
 } memfuns_t;
 
+/* Buckets of the CXQ_OPT_TIMESTAMP histogram.  Bucket b counts times in
+   [2^b, 2^(b+1)) ns, bucket 0 also counts 0, and the last bucket counts
+   everything longer. */
+#ifndef CXQ_HIST_BUCKETS
+#define CXQ_HIST_BUCKETS    40
+#endif
+
+/* Callback for cxq_watch. */
+typedef void (*cxq_notify_t)(void *arg, int tag);
+
+/* Residence time histogram kept with CXQ_OPT_TIMESTAMP. */
+typedef struct {
+    uint64_t count[CXQ_HIST_BUCKETS];   /* Elements per bucket. */
+    uint64_t total;         /* Elements recorded. */
+    uint64_t sum_ns;        /* Sum of their residence times. */
+    uint64_t max_ns;        /* Longest residence time. */
+} cxq_hist_t;
+
+/* Counters kept with CXQ_STATS, see cxq_get_stats. */
+typedef struct {
+    uint64_t enqueued;      /* Elements added. */
+    uint64_t dequeued;      /* Elements removed by dequeue or release. */
+    uint64_t rejected;      /* Elements refused, queue full. */
+    uint64_t overwritten;   /* Elements dropped by circular mode. */
+    int high_water;         /* Largest count seen. */
+    uint64_t lock_waits;    /* Times LOCK found the mutex taken. */
+    uint64_t lock_wait_ns;  /* Total time spent waiting for it. */
+} cxq_stats_t;
+
 typedef struct {
     void *data;             /* Pointer to body of queue. */
     int first;              /* Position of first element. */
     int count;              /* Pumber of queue elements. */
     int slots;              /* Num of queue slots. */
     int data_size;          /* Size of each element. */
+    int stride;             /* Bytes from one slot to the next. */
     bool circular;          /* This is a circular buffer. */
+    bool reserved;          /* Slot after last handed out by cxq_reserve. */
+    bool held;              /* First element handed out by cxq_peek. */
+    int options;            /* CXQ_OPT_* flags given at init. */
+    unsigned mask;          /* CXQ_OPT_POW2: slots - 1. */
+    int min_slots;          /* Growable: slots given at init. */
+    int max_slots;          /* Growable: cap on slots, 0 = fixed size. */
+    int low_ops;            /* Growable: enqueues spent under low water. */
+    uint64_t *stamps;       /* CXQ_OPT_TIMESTAMP: enqueue time per slot. */
+    cxq_hist_t *hist;       /* CXQ_OPT_TIMESTAMP: residence times. */
+    int fd;                 /* CXQ_OPT_EVENTFD: not empty, or -1. */
+    int space_fd;           /* CXQ_OPT_EVENTFD_SPACE: not full, or -1. */
+    cxq_notify_t notify_fn; /* cxq_watch: called when not empty, or NULL. */
+    void *notify_arg;       /* cxq_watch: first arg of notify_fn. */
+    int notify_tag;         /* cxq_watch: second arg of notify_fn. */
     memfuns_t *handlers;    /* Memory callback functions. */
 #ifdef MULTI_THREAD
-    osMutexId_t lock;       /* Queue lock. */
+    cxq_mutex_t lock;       /* Queue lock. */
+    cxq_sem_t not_empty;    /* Posted to wake a parked reader. */
+    cxq_sem_t not_full;     /* Posted to wake a parked writer. */
+    int rd_waiting;         /* Readers parked on not_empty. */
+    int wr_waiting;         /* Writers parked on not_full. */
+#endif
+    CXQ_PAD(pad0)
+    cxq_atomic_uint tail;   /* SPSC: producer position. */
+    unsigned head_cache;    /* SPSC: producer's last look at head. */
+#ifdef CXQ_STATS
+    cxq_stats_t stats;      /* SPSC: all but dequeued are the producer's. */
+#endif
+    CXQ_PAD(pad1)
+    cxq_atomic_uint head;   /* SPSC: consumer position. */
+    unsigned tail_cache;    /* SPSC: consumer's last look at tail. */
+#ifdef CXQ_STATS
+    uint64_t dequeued;      /* SPSC: consumer's count of elements removed. */
 #endif
+    CXQ_PAD(pad2)
 } cxq_t;
 
 /* construction/destruction */
 void cxq_init(cxq_t *q, int slots, int data_size, memfuns_t *handlers);
+void cxq_init_ex(cxq_t *q, int slots, int data_size, memfuns_t *handlers,
+                 int options);
 void cxq_finish(cxq_t *q);
 
 /* get/set queue options */
 bool cxq_get_circular(const cxq_t *q);
 void cxq_set_circular(cxq_t *q);
+void cxq_set_growth(cxq_t *q, int max_slots);
 int cxq_get_first(const cxq_t *q);
 void cxq_set_first(cxq_t *q, int first);
 int cxq_get_last(const cxq_t *q);
 int cxq_get_count(const cxq_t *q);
 int cxq_get_slots(const cxq_t *q);
 int cxq_get_data_size(const cxq_t *q);
+int cxq_get_fd(const cxq_t *q);
+int cxq_get_space_fd(const cxq_t *q);
+void cxq_watch(cxq_t *q, cxq_notify_t fn, void *arg, int tag);
 
 /* enqueue/dequeue/flush */
 void * cxq_enqueue(cxq_t *q, const void *data);
 void * cxq_enqueue_front(cxq_t *q, const void *data);
 void * cxq_dequeue(cxq_t *q, void *data, bool remove);
+int    cxq_enqueue_n(cxq_t *q, const void *src, int n);
+int    cxq_dequeue_n(cxq_t *q, void *dst, int n, bool remove);
 void   cxq_flush(cxq_t *q);
 
+/* move/swap enqueue/dequeue */
+void * cxq_enqueue_swap(cxq_t *q, void *data);
+void * cxq_dequeue_swap(cxq_t *q, void *data);
+void * cxq_enqueue_move(cxq_t *q, void *data);
+void * cxq_dequeue_move(cxq_t *q, void *data);
+
+/* zero-copy reserve/commit and peek/release */
+void * cxq_reserve(cxq_t *q);
+void   cxq_commit(cxq_t *q);
+void * cxq_peek(cxq_t *q);
+void   cxq_release(cxq_t *q);
+void * cxq_peek_span(cxq_t *q, int *n);
+
+/* blocking enqueue/dequeue, timeout in ms or CXQ_WAIT_FOREVER */
+void * cxq_enqueue_wait(cxq_t *q, const void *data, uint32_t timeout);
+void * cxq_dequeue_wait(cxq_t *q, void *data, uint32_t timeout);
+
 /* isempty/isfull/slots_empty/slots_filled */
 bool cxq_isempty(const cxq_t *q);
 bool cxq_isfull(const cxq_t *q);
 int cxq_slots_empty(const cxq_t *q);
 int cxq_slots_filled(const cxq_t *q);
 
+/* helpers */
+int cxq_pow2_roundup(int n);
+
+/* statistics, all zero without CXQ_STATS */
+void cxq_get_stats(cxq_t *q, cxq_stats_t *stats);
+void cxq_reset_stats(cxq_t *q);
+
+/* residence time histogram, CXQ_OPT_TIMESTAMP only */
+void cxq_get_hist(cxq_t *q, cxq_hist_t *hist);
+void cxq_reset_hist(cxq_t *q);
+uint64_t cxq_hist_percentile(const cxq_hist_t *hist, double p);
+
 /* dianostics */
 typedef void (*cxq_callback_t)(const void *data);
 void cxq_traverse(const cxq_t *q, cxq_callback_t peekfun);
 
+/* span traversal, n elements `stride` bytes apart from `data` */
+typedef struct {
+    void *data;             /* First element of the range. */
+    int n;                  /* Number of elements. */
+} cxq_span_t;
+typedef void (*cxq_span_fn_t)(const void *data, int n, int stride, void *arg);
+int  cxq_get_spans(const cxq_t *q, cxq_span_t span[2]);
+void cxq_traverse_spans(const cxq_t *q, cxq_span_fn_t fn, void *arg);
+
 
 #endif /* CXQ_H_ */
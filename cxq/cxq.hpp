@@ -0,0 +1,127 @@
+/******************************************************************************
+
+ cxq.hpp - C++ type specialized queue
+
+ cxq::queue<T, N> is the C++ counterpart of CXQ_DECLARE in cxq_typed.h.
+ Element type and capacity are template parameters, storage is inline,
+ and elements are copied (or moved) by plain assignment.  It has no lock;
+ guard it yourself if it's shared between threads.
+
+*******************************************************************************/
+
+#ifndef CXQ_HPP
+#define CXQ_HPP
+
+#include <cstddef>
+#include <utility>
+
+namespace cxq {
+
+template <typename T, std::size_t N>
+class queue {
+    static_assert(N > 0, "cxq::queue needs at least one slot");
+
+public:
+    queue() : first_(0), count_(0), circular_(false) {}
+
+    /* get/set queue options */
+    bool get_circular() const {return circular_;}
+    void set_circular() {circular_ = true;}
+    std::size_t get_count() const {return count_;}
+    static constexpr std::size_t get_slots() {return N;}
+
+    /* enqueue/dequeue/flush */
+    T * enqueue(const T &data) {
+        if (!make_room())
+            return nullptr;
+        T *slot = &data_[(first_ + count_) % N];
+        *slot = data;
+        count_++;
+        return slot;
+    }
+
+    T * enqueue(T &&data) {
+        if (!make_room())
+            return nullptr;
+        T *slot = &data_[(first_ + count_) % N];
+        *slot = std::move(data);
+        count_++;
+        return slot;
+    }
+
+    T * enqueue_front(const T &data) {
+        if (!make_room())
+            return nullptr;
+        std::size_t front = first_ ? first_ - 1 : N - 1;
+        data_[front] = data;
+        first_ = front;
+        count_++;
+        return &data_[first_];
+    }
+
+    /* Copy first element to `data`, optionally remove it.  Returns a
+       pointer to the element, or nullptr if the queue is empty. */
+    T * dequeue(T *data, bool remove) {
+        if (count_ == 0)
+            return nullptr;
+        T *slot = &data_[first_];
+        if (data) *data = *slot;
+        if (remove) {
+            first_ = (first_ + 1) % N;
+            count_--;
+        }
+        return slot;
+    }
+
+    /* Move first element out and remove it.  Returns false if empty. */
+    bool dequeue(T &data) {
+        if (count_ == 0)
+            return false;
+        data = std::move(data_[first_]);
+        first_ = (first_ + 1) % N;
+        count_--;
+        return true;
+    }
+
+    void flush() {
+        first_ = (first_ + count_) % N;
+        count_ = 0;
+    }
+
+    /* isempty/isfull/slots_empty/slots_filled */
+    bool isempty() const {return count_ == 0;}
+    bool isfull() const {return count_ >= N;}
+    std::size_t slots_empty() const {return N - count_;}
+    std::size_t slots_filled() const {return count_;}
+
+    /* Call peekfun(const T &) for each element, first to last. */
+    template <typename F>
+    void traverse(F peekfun) const {
+        std::size_t index = first_;
+        for (std::size_t i = 0; i < count_; i++) {
+            peekfun(data_[index]);
+            index = (index + 1) % N;
+        }
+    }
+
+private:
+    /* In circular mode drop the oldest element when full.  Returns
+       false if there is still no room. */
+    bool make_room() {
+        if (count_ < N)
+            return true;
+        if (!circular_)
+            return false;
+        dequeue(nullptr, true);
+        return true;
+    }
+
+    T data_[N];             /* Body of queue. */
+    std::size_t first_;     /* Position of first element. */
+    std::size_t count_;     /* Number of queue elements. */
+    bool circular_;         /* This is a circular buffer. */
+};
+
+} /* namespace cxq */
+
+#endif /* CXQ_HPP */
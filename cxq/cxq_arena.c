@@ -0,0 +1,166 @@
+/******************************************************************************
+
+ cxq_arena.c - slot arena for queues of structs with nested buffers
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cxq_arena.h"
+
+/* Options the arena can't serve: they map a body of their own. */
+#define ARENA_NO_OPTS   (CXQ_OPT_MIRROR | CXQ_OPT_HUGEPAGE)
+
+
+/* Alignment of body and buffers, at least what CXQ_OPT_ALIGN asks the
+   slots for.  A power of two. */
+static size_t _arena_align(const cxq_arena_t *a, int options) {
+    size_t align = a->align ? a->align : _Alignof(max_align_t);
+    size_t slot_align = (unsigned)options >> 16;
+    return (slot_align > align) ? slot_align : align;
+}
+
+
+/* Slot stride for `options`, as cxq_init_ex computes it. */
+static size_t _arena_stride(const cxq_arena_t *a, int options) {
+    size_t align = (unsigned)options >> 16;
+    return align ? (a->elem_size + align - 1) & ~(align - 1) : a->elem_size;
+}
+
+
+/* Round n up to a multiple of align. */
+static size_t _round_up(size_t n, size_t align) {
+    return (n + align - 1) & ~(align - 1);
+}
+
+
+/* Bytes for `slots` slots `stride` apart, plus their nested buffers. */
+static size_t _arena_bytes(const cxq_arena_t *a, int slots, size_t stride,
+                           size_t align) {
+    size_t bytes = _round_up(slots * stride, align);
+    for (int m = 0; m < a->num_members; m++)
+        bytes += slots * _round_up(a->members[m].size, align);
+    return bytes;
+}
+
+
+/*
+  Description
+    Compute the bytes needed for a queue body of `slots` elements plus
+    every slot's nested buffers.  Use it to size a static region.
+
+  Parameters
+    a          - Pointer to cxq_arena_t struct.
+    slots      - Number of queue positions.
+    options    - CXQ_OPT_* flags the queue will be inited with.
+
+  Returns
+    Number of bytes.
+*/
+size_t cxq_arena_size(const cxq_arena_t *a, int slots, int options) {
+    if (options & CXQ_OPT_POW2)
+        slots = cxq_pow2_roundup(slots);
+    return _arena_bytes(a, slots, _arena_stride(a, options),
+                        _arena_align(a, options));
+}
+
+
+/*
+  Description
+    Lay out a queue body of `slots` slots `stride` apart, followed by
+    the nested buffers, slot by slot, so each slot's buffers sit next to
+    each other, and point every member at its buffer.
+
+  Parameters
+    a          - Pointer to cxq_arena_t struct.
+    slots      - Number of queue positions.
+    stride     - Bytes from one slot to the next.
+    align      - Alignment of body and buffers.
+
+  Returns
+    Pointer to the queue body, or NULL if the allocation fails, or the
+    static region is too small or misaligned.
+*/
+static void * _arena_carve(cxq_arena_t *a, int slots, size_t stride,
+                           size_t align) {
+    size_t bytes = _arena_bytes(a, slots, stride, align);
+    char *block;
+    if (a->region) {
+        if (bytes > a->region_size || (uintptr_t)a->region & (align - 1))
+            return NULL;
+        block = a->region;
+    } else {
+        block = aligned_alloc(align, bytes);
+        if (!block)
+            return NULL;
+    }
+
+    char *cursor = block + _round_up(slots * stride, align);
+    for (int i = 0; i < slots; i++) {
+        char *slot = block + i * stride;
+        for (int m = 0; m < a->num_members; m++) {
+            *(void **)(slot + a->members[m].offset) = cursor;
+            cursor += _round_up(a->members[m].size, align);
+        }
+    }
+
+    a->block = block;
+    a->bytes = bytes;
+    a->slots = slots;
+    /* One malloc per member per slot, plus the body when static. */
+    a->allocs_saved = slots * a->num_members + (a->region ? 1 : 0);
+    a->bytes_saved = a->allocs_saved * (size_t)CXQ_ARENA_MALLOC_OVERHEAD;
+    return block;
+}
+
+
+/*
+  Description
+    Init the queue with its body and every slot's nested buffers carved
+    from arena `a`.  Elements are a->elem_size bytes.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    a          - Pointer to cxq_arena_t struct, set up by the caller.
+    slots      - Number of queue positions.
+    handlers   - Pointer to memfuns_t struct for memcpy_fn, move_fn and
+                 swap_fn, or NULL for memcpy.  malloc_fn and free_fn are
+                 ignored; the arena owns the memory.
+    options    - CXQ_OPT_* flags, as for cxq_init_ex.  CXQ_OPT_MIRROR
+                 and CXQ_OPT_HUGEPAGE are cleared.
+
+  Returns
+    None.  If the arena can't be carved, q->data and a->block are NULL.
+
+  Note
+    The body is carved once and never reallocated, so cxq_set_growth
+    has no effect.  cxq_finish frees an allocated block; a static region
+    is left alone.
+*/
+void cxq_init_arena(cxq_t *q, cxq_arena_t *a, int slots, memfuns_t *handlers,
+                    int options) {
+    memfuns_t h = {NULL, NULL, memcpy, NULL, NULL};
+    if (handlers) {
+        h.memcpy_fn = handlers->memcpy_fn;
+        h.move_fn = handlers->move_fn;
+        h.swap_fn = handlers->swap_fn;
+    }
+    /* No malloc_fn: cxq_init_ex sizes the queue and leaves the body to
+       us.  The body is at the start of the block, so free() releases it
+       all at once. */
+    h.free_fn = a->region ? NULL : free;
+    a->block = NULL;
+    cxq_init_ex(q, slots, a->elem_size, &h, options & ~ARENA_NO_OPTS);
+    q->data = _arena_carve(a, q->slots, q->stride,
+                           _arena_align(a, q->options));
+}
+
+
+/* Print arena usage and what it saved. */
+void cxq_arena_print(const cxq_arena_t *a) {
+    printf("arena: %d slots, %zu bytes in 1 block, "
+           "%d mallocs saved (~%zu bytes of overhead)\n",
+           a->slots, a->bytes, a->allocs_saved, a->bytes_saved);
+}
@@ -0,0 +1,76 @@
+/******************************************************************************
+
+ cxq_arena.h - slot arena for queues of structs with nested buffers
+
+ Carves the queue body and every slot's nested member buffers out of a
+ single aligned allocation, or out of a caller-supplied static region,
+ instead of one malloc per member per slot.
+
+ Describe the pointer members to fill in, then init the queue on the
+ arena:
+
+    static const cxq_arena_member_t members[] = {
+        {offsetof(person_t, first_name), 32},
+        {offsetof(person_t, last_name), 32},
+    };
+    cxq_arena_t arena = {
+        .elem_size = sizeof(person_t),
+        .members = members,
+        .num_members = 2,
+    };
+    memfuns_t handlers = {.memcpy_fn = my_memcpy};
+    cxq_init_arena(&q, &arena, slots, &handlers, CXQ_OPT_NONE);
+
+ The arena is laid out for the queue's real slot count and stride, so
+ CXQ_OPT_POW2 and CXQ_OPT_ALIGN work as usual.  The body is carved
+ once, so the queue can't grow, and CXQ_OPT_MIRROR and
+ CXQ_OPT_HUGEPAGE, which map their own body, are cleared.
+
+*******************************************************************************/
+
+#ifndef CXQ_ARENA_H
+#define CXQ_ARENA_H
+
+#include <stddef.h>
+
+#include "cxq.h"
+
+/* Estimated per-allocation overhead of the system malloc, in bytes. */
+#ifndef CXQ_ARENA_MALLOC_OVERHEAD
+#define CXQ_ARENA_MALLOC_OVERHEAD 16
+#endif
+
+typedef struct {
+    size_t offset;          /* offsetof() a pointer member of the element. */
+    size_t size;            /* Bytes to give that member in every slot. */
+} cxq_arena_member_t;
+
+typedef struct {
+    /* Set by the caller. */
+    size_t elem_size;       /* Size of each queue element. */
+    const cxq_arena_member_t *members;  /* Pointer members to fill in. */
+    int num_members;        /* Length of members. */
+    size_t align;           /* Alignment of body and buffers, 0 = default. */
+    void *region;           /* Static region to carve from, or NULL. */
+    size_t region_size;     /* Size of region. */
+
+    /* Filled in by the arena. */
+    void *block;            /* Start of the carved memory. */
+    size_t bytes;           /* Bytes used, body plus nested buffers. */
+    int slots;              /* Number of slots carved. */
+    int allocs_saved;       /* malloc calls avoided. */
+    size_t bytes_saved;     /* Estimated malloc overhead avoided. */
+} cxq_arena_t;
+
+/* construction */
+void cxq_init_arena(cxq_t *q, cxq_arena_t *a, int slots, memfuns_t *handlers,
+                    int options);
+
+/* size query, for sizing a static region */
+size_t cxq_arena_size(const cxq_arena_t *a, int slots, int options);
+
+/* diagnostics */
+void cxq_arena_print(const cxq_arena_t *a);
+
+
+#endif /* CXQ_ARENA_H */
@@ -0,0 +1,246 @@
+/******************************************************************************
+
+ cxq_bcast.c - broadcast ring, one writer and many readers
+
+ Cursors and `tail` are 64-bit sequence numbers that never wrap in
+ practice, so a reader's backlog is just tail - cursor, and element
+ `seq` lives in slot seq % slots.
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cxq_bcast.h"
+
+#define BIT32(x)    ((uint32_t)1 << (x))
+
+
+/* Returns true if `reader` is an attached reader. */
+static inline bool _bcast_valid(const cxq_bcast_t *q, int reader) {
+    return reader >= 0 && reader < CXQ_BCAST_READERS
+        && (q->attached & BIT32(reader));
+}
+
+
+/* Cursor of the slowest attached reader, or tail if there are none.
+   Lock must be held. */
+static uint64_t _bcast_slowest(const cxq_bcast_t *q) {
+    uint64_t min = q->tail;
+    for (uint32_t r = q->attached; r; r &= r - 1) {
+#ifdef __GNUC__
+        int i = __builtin_ctz(r);
+#else
+        int i = 0;
+        while (!(r & BIT32(i)))
+            i++;
+#endif
+        if (q->cursor[i] < min)
+            min = q->cursor[i];
+    }
+    return min;
+}
+
+
+/*
+  Description
+    Init the ring, in lossless mode with no readers.
+
+  Parameters
+    q          - Pointer to cxq_bcast_t struct.
+    slots      - Number of ring positions.
+    data_size  - The size of each element.
+    handlers   - Pointer to memfuns_t stuct that manages memory allocation
+                 for elements, as for cxq_init.  memcpy_fn is called once
+                 per element written and once per element read by each
+                 reader.
+
+  Returns
+    0, or -1 if `slots` isn't positive.  The ring is unusable then and
+    must still be finished.
+*/
+int cxq_bcast_init(cxq_bcast_t *q, int slots, int data_size,
+                   memfuns_t *handlers) {
+    q->slots = slots;
+    q->data = NULL;
+    q->data_size = data_size;
+    q->circular = false;
+    q->tail = 0;
+    q->attached = 0;
+    q->handlers = malloc(sizeof(memfuns_t));
+    if (handlers) {
+        q->handlers->malloc_fn = handlers->malloc_fn;
+        q->handlers->free_fn = handlers->free_fn;
+        q->handlers->memcpy_fn = handlers->memcpy_fn;
+        q->handlers->move_fn = handlers->move_fn;
+        q->handlers->swap_fn = handlers->swap_fn;
+    } else {
+        /* Default handlers. */
+        q->handlers->malloc_fn = malloc;
+        q->handlers->free_fn = free;
+        q->handlers->memcpy_fn = memcpy;
+        q->handlers->move_fn = NULL;
+        q->handlers->swap_fn = NULL;
+    }
+    MUTEX_INIT(q->lock, NULL);
+    if (slots <= 0)
+        return -1;
+    if (q->handlers->malloc_fn)
+        q->data = q->handlers->malloc_fn(slots * data_size);
+    return 0;
+}
+
+
+/*
+  Description
+    De-init ring, free memory.
+
+  Parameters
+    q          - Pointer to cxq_bcast_t struct.
+
+  Returns
+    None
+*/
+void cxq_bcast_finish(cxq_bcast_t *q) {
+    MUTEX_DESTROY(q->lock);
+    if (q->data && q->handlers->free_fn)
+        q->handlers->free_fn(q->data);
+    free(q->handlers);
+}
+
+
+/* Never hold the writer back; overrun slow readers instead. */
+void cxq_bcast_set_circular(cxq_bcast_t *q) {q->circular = true;}
+
+
+/*
+  Description
+    Attach a reader.  It starts at the next element written; elements
+    already in the ring are not replayed.
+
+  Parameters
+    q          - Pointer to cxq_bcast_t struct.
+
+  Returns
+    Reader id for cxq_bcast_dequeue, or -1 if CXQ_BCAST_READERS are
+    already attached.
+*/
+int cxq_bcast_attach(cxq_bcast_t *q) {
+    int reader = -1;
+    LOCK(q->lock);
+    for (int i = 0; i < CXQ_BCAST_READERS; i++) {
+        if (!(q->attached & BIT32(i))) {
+            q->cursor[i] = q->tail;
+            q->attached |= BIT32(i);
+            reader = i;
+            break;
+        }
+    }
+    UNLOCK(q->lock);
+    return reader;
+}
+
+
+/* Detach a reader.  In lossless mode this may free the writer. */
+void cxq_bcast_detach(cxq_bcast_t *q, int reader) {
+    LOCK(q->lock);
+    if (_bcast_valid(q, reader))
+        q->attached &= ~BIT32(reader);
+    UNLOCK(q->lock);
+}
+
+
+/*
+  Description
+    Write an element for all attached readers.
+
+  Parameters
+    q          - Pointer to cxq_bcast_t struct.
+    data       - Pointer to source memory for the element.
+
+  Returns
+    slot - A pointer to the element in the ring, or NULL if in lossless
+    mode the slowest reader still has `slots` elements to read.
+*/
+void * cxq_bcast_enqueue(cxq_bcast_t *q, const void *data) {
+    void * slot = NULL;
+    LOCK(q->lock);
+    if (q->circular || q->tail - _bcast_slowest(q) < (uint64_t)q->slots) {
+        slot = q->data + (q->tail % q->slots) * q->data_size;
+        if (q->handlers->memcpy_fn)
+            q->handlers->memcpy_fn(slot, data, q->data_size);
+        q->tail++;
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/*
+  Description
+    Read the next element for `reader`.  Other readers still see it.
+
+  Parameters
+    q          - Pointer to cxq_bcast_t struct.
+    reader     - Reader id from cxq_bcast_attach.
+    data       - Pointer to destination memory for the element.
+    lost       - If not NULL, set to the number of elements the reader
+                 missed because the writer overran it in circular mode,
+                 or 0.
+
+  Returns
+    slot - A pointer to the element in the ring, or NULL if the reader
+    has nothing left to read or isn't attached.  In circular mode the
+    slot may be overwritten by the next write.
+*/
+void * cxq_bcast_dequeue(cxq_bcast_t *q, int reader, void *data, int *lost) {
+    void * slot = NULL;
+    int missed = 0;
+    LOCK(q->lock);
+    if (_bcast_valid(q, reader)) {
+        uint64_t *cursor = &q->cursor[reader];
+        if (q->tail - *cursor > (uint64_t)q->slots) {
+            /* Overrun, skip to the oldest element still in the ring. */
+            missed = q->tail - q->slots - *cursor;
+            *cursor = q->tail - q->slots;
+        }
+        if (*cursor < q->tail) {
+            slot = q->data + (*cursor % q->slots) * q->data_size;
+            if (data && q->handlers->memcpy_fn)
+                q->handlers->memcpy_fn(data, slot, q->data_size);
+            (*cursor)++;
+        }
+    }
+    UNLOCK(q->lock);
+    if (lost)
+        *lost = missed;
+    return slot;
+}
+
+
+/* Returns num of elements `reader` has left to read, up to slots. */
+int cxq_bcast_get_count(const cxq_bcast_t *q, int reader) {
+    uint64_t n = 0;
+    /* 64-bit reads can tear on 32-bit targets, so take the lock. */
+    LOCK(q->lock);
+    if (_bcast_valid(q, reader))
+        n = q->tail - q->cursor[reader];
+    UNLOCK(q->lock);
+    return (n < (uint64_t)q->slots) ? (int)n : q->slots;
+}
+
+
+/* Returns true if `reader` has nothing left to read. */
+bool cxq_bcast_isempty(const cxq_bcast_t *q, int reader) {
+    return cxq_bcast_get_count(q, reader) <= 0;
+}
+
+
+/* Returns true if a lossless write would fail now. */
+bool cxq_bcast_isfull(const cxq_bcast_t *q) {
+    bool full;
+    LOCK(q->lock);
+    full = !q->circular && q->tail - _bcast_slowest(q) >= (uint64_t)q->slots;
+    UNLOCK(q->lock);
+    return full;
+}
@@ -0,0 +1,56 @@
+/******************************************************************************
+
+ cxq_bcast.h - broadcast ring, one writer and many readers
+
+ The writer copies each element into the ring once, and every attached
+ reader keeps its own cursor, a sequence number, into it.  In lossless
+ mode the writer is held back by the slowest reader; in circular mode
+ it never waits, and a reader that falls more than `slots` elements
+ behind is moved up to the oldest element still in the ring and told
+ how many it lost.  Readers can attach and detach at any time.
+
+*******************************************************************************/
+
+#ifndef CXQ_BCAST_H
+#define CXQ_BCAST_H
+
+#include "cxq.h"
+
+/* Max number of readers, one bit each in `attached`. */
+#define CXQ_BCAST_READERS   32
+
+typedef struct {
+    void *data;             /* Pointer to body of ring. */
+    int slots;              /* Num of ring slots. */
+    int data_size;          /* Size of each element. */
+    bool circular;          /* Overrun slow readers instead of waiting. */
+    uint64_t tail;          /* Sequence number of the next element. */
+    uint64_t cursor[CXQ_BCAST_READERS]; /* Next element for each reader. */
+    uint32_t attached;      /* Bit n set while reader n is attached. */
+    memfuns_t *handlers;    /* Memory callback functions. */
+#ifdef MULTI_THREAD
+    cxq_mutex_t lock;       /* Ring lock. */
+#endif
+} cxq_bcast_t;
+
+/* construction/destruction */
+int  cxq_bcast_init(cxq_bcast_t *q, int slots, int data_size,
+                    memfuns_t *handlers);
+void cxq_bcast_finish(cxq_bcast_t *q);
+void cxq_bcast_set_circular(cxq_bcast_t *q);
+
+/* readers */
+int  cxq_bcast_attach(cxq_bcast_t *q);
+void cxq_bcast_detach(cxq_bcast_t *q, int reader);
+
+/* write/read */
+void * cxq_bcast_enqueue(cxq_bcast_t *q, const void *data);
+void * cxq_bcast_dequeue(cxq_bcast_t *q, int reader, void *data, int *lost);
+
+/* count/isempty/isfull */
+int  cxq_bcast_get_count(const cxq_bcast_t *q, int reader);
+bool cxq_bcast_isempty(const cxq_bcast_t *q, int reader);
+bool cxq_bcast_isfull(const cxq_bcast_t *q);
+
+
+#endif /* CXQ_BCAST_H */
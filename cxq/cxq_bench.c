@@ -0,0 +1,234 @@
+#include "cxq.h"
+
+//#define CXQ_BENCH
+
+#ifdef CXQ_BENCH
+
+/* Throughput and latency benchmark for cxq_t.  Sweeps element size,
+   slot count, plain versus circular mode, default versus custom
+   memfuns_t handlers, and 1..N producer/consumer thread pairs, plus
+   the CXQ_OPT_SPSC mode for a single pair.  Each run moves `items`
+   elements and reports ops/sec and the p50/p99/p99.9 enqueue to
+   dequeue latency in ns.  In circular mode, elements overwritten before
+   they are dequeued are counted as dropped and have no latency.
+
+   Without MULTI_THREAD the queue is guarded by one pthread mutex, the
+   way MULTI_THREAD builds serialize on q->lock.  Build with -pthread.
+   Usage: ./a.out [max_threads] [items] [csv|json]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define MAX_SIZE    4096
+
+static const int sizes[] = {4, 64, 512, 4096};
+static const int slot_counts[] = {16, 1024};
+
+typedef struct {
+    int size;               /* Element size in bytes. */
+    int slots;              /* Queue slots. */
+    bool circular;          /* Circular mode. */
+    bool custom;            /* Custom memfuns_t handlers. */
+    bool spsc;              /* CXQ_OPT_SPSC, one pair only. */
+    int threads;            /* Producer/consumer pairs. */
+} bench_cfg_t;
+
+typedef struct {
+    double ops_per_sec;     /* Elements enqueued per second. */
+    long dropped;           /* Overwritten in circular mode. */
+    double p50, p99, p999;  /* Latency percentiles in ns. */
+} bench_result_t;
+
+static cxq_t q;
+static bench_cfg_t cfg;
+static int per_thread;
+static uint64_t *t_enq;     /* Enqueue time of each sequence number. */
+static uint64_t *lat;       /* Latency of each dequeued element. */
+static atomic_int lat_count;
+static atomic_int producers_left;
+#ifndef MULTI_THREAD
+static pthread_mutex_t bench_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Custom handlers: the built-in calls behind a function pointer, which
+   also takes the per-element copy path of the batch calls. */
+static void * my_malloc(size_t size) {return malloc(size);}
+static void my_free(void *ptr) {free(ptr);}
+static void * my_memcpy(void *dest, const void *src, size_t n) {
+    return memcpy(dest, src, n);
+}
+
+static memfuns_t custom_handlers = {my_malloc, my_free, my_memcpy, NULL, NULL};
+
+/* The queue guards itself in MULTI_THREAD builds and in SPSC mode. */
+static void bench_lock_acquire(void) {
+#ifndef MULTI_THREAD
+    if (!cfg.spsc)
+        pthread_mutex_lock(&bench_lock);
+#endif
+}
+
+static void bench_lock_release(void) {
+#ifndef MULTI_THREAD
+    if (!cfg.spsc)
+        pthread_mutex_unlock(&bench_lock);
+#endif
+}
+
+/* Elements carry their sequence number in the first 4 bytes. */
+static void * producer(void *arg) {
+    unsigned char data[MAX_SIZE] = {0};
+    uint32_t seq = (uintptr_t)arg * per_thread;
+    for (int i = 0; i < per_thread; i++, seq++) {
+        memcpy(data, &seq, sizeof(seq));
+        for (;;) {
+            t_enq[seq] = now_ns();
+            bench_lock_acquire();
+            void *slot = cxq_enqueue(&q, data);
+            bench_lock_release();
+            if (slot) break;
+            sched_yield();
+        }
+    }
+    atomic_fetch_sub(&producers_left, 1);
+    return NULL;
+}
+
+/* Dequeue until the producers are done and the queue is empty. */
+static void * consumer(void *arg) {
+    unsigned char data[MAX_SIZE];
+    (void)arg;
+    for (;;) {
+        bool done = atomic_load(&producers_left) == 0;
+        bench_lock_acquire();
+        void *slot = cxq_dequeue(&q, data, true);
+        bench_lock_release();
+        if (slot) {
+            uint64_t t = now_ns();
+            uint32_t seq;
+            memcpy(&seq, data, sizeof(seq));
+            lat[atomic_fetch_add(&lat_count, 1)] = t - t_enq[seq];
+        } else if (done) {
+            break;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Percentile p (0..1) of the n sorted latencies. */
+static double percentile(int n, double p) {
+    if (n == 0)
+        return 0;
+    int i = (int)(p * (n - 1) + 0.5);
+    return lat[i];
+}
+
+/* Run one configuration with `items` elements in total. */
+static bench_result_t run(int items) {
+    bench_result_t r;
+    int n = cfg.threads;
+    pthread_t tid[2 * n];
+
+    cxq_init_ex(&q, cfg.slots, cfg.size, cfg.custom ? &custom_handlers : NULL,
+                cfg.spsc ? CXQ_OPT_SPSC : CXQ_OPT_NONE);
+    if (cfg.circular)
+        cxq_set_circular(&q);
+    per_thread = items / n;
+    atomic_store(&lat_count, 0);
+    atomic_store(&producers_left, n);
+
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        pthread_create(&tid[i], NULL, consumer, NULL);
+        pthread_create(&tid[n + i], NULL, producer, (void *)(uintptr_t)i);
+    }
+    for (int i = 0; i < 2 * n; i++)
+        pthread_join(tid[i], NULL);
+    uint64_t t1 = now_ns();
+    cxq_finish(&q);
+
+    int got = atomic_load(&lat_count);
+    qsort(lat, got, sizeof(lat[0]), cmp_u64);
+    r.ops_per_sec = (double)per_thread * n * 1e9 / (t1 - t0);
+    r.dropped = (long)per_thread * n - got;
+    r.p50 = percentile(got, 0.50);
+    r.p99 = percentile(got, 0.99);
+    r.p999 = percentile(got, 0.999);
+    return r;
+}
+
+static void print_result(bool json, bool first, const bench_result_t *r) {
+    const char *mode = cfg.spsc ? "spsc" : "locked";
+    if (json) {
+        printf("%s\n  {\"mode\": \"%s\", \"size\": %d, \"slots\": %d, "
+               "\"circular\": %s, \"handlers\": \"%s\", \"threads\": %d, "
+               "\"ops_per_sec\": %.0f, \"dropped\": %ld, "
+               "\"p50_ns\": %.0f, \"p99_ns\": %.0f, \"p999_ns\": %.0f}",
+               first ? "" : ",", mode, cfg.size, cfg.slots,
+               cfg.circular ? "true" : "false",
+               cfg.custom ? "custom" : "default", cfg.threads,
+               r->ops_per_sec, r->dropped, r->p50, r->p99, r->p999);
+    } else {
+        printf("%s,%d,%d,%d,%s,%d,%.0f,%ld,%.0f,%.0f,%.0f\n",
+               mode, cfg.size, cfg.slots, cfg.circular,
+               cfg.custom ? "custom" : "default", cfg.threads,
+               r->ops_per_sec, r->dropped, r->p50, r->p99, r->p999);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int max_threads = (argc > 1) ? atoi(argv[1]) : 2;
+    int items = (argc > 2) ? atoi(argv[2]) : 1 << 16;
+    bool json = (argc > 3) && strcmp(argv[3], "json") == 0;
+    bool first = true;
+
+    t_enq = malloc(items * sizeof(t_enq[0]));
+    lat = malloc(items * sizeof(lat[0]));
+
+    if (json)
+        printf("[");
+    else
+        printf("mode,size,slots,circular,handlers,threads,"
+               "ops_per_sec,dropped,p50_ns,p99_ns,p999_ns\n");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    for (size_t k = 0; k < sizeof(slot_counts) / sizeof(slot_counts[0]); k++)
+    for (int circ = 0; circ < 2; circ++)
+    for (int custom = 0; custom < 2; custom++)
+    for (int spsc = 0; spsc < 2; spsc++)
+    for (int n = 1; n <= max_threads; n++) {
+        /* SPSC is one pair, and never overwrites. */
+        if (spsc && (n > 1 || circ))
+            continue;
+        cfg = (bench_cfg_t){sizes[s], slot_counts[k], circ, custom, spsc, n};
+        bench_result_t r = run(items);
+        print_result(json, first, &r);
+        first = false;
+        fflush(stdout);
+    }
+    if (json)
+        printf("\n]\n");
+
+    free(t_enq);
+    free(lat);
+}
+
+#endif /*CXQ_BENCH*/
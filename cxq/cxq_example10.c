@@ -0,0 +1,58 @@
+#include "cxq_typed.h"
+
+//#define CXQ_EXAMPLE10
+
+#ifdef CXQ_EXAMPLE10
+
+/* Demonstrates the type specialized queue from cxq_typed.h.  Same as
+   cxq_example1.c, but the element type and number of slots are fixed at
+   compile time, the data array lives inside the queue struct, and
+   elements are copied by assignment instead of through memcpy_fn.
+*/
+
+#include <stdio.h>
+
+/* Generate intq_t and the intq_* functions. */
+CXQ_DECLARE(intq, int, 10)
+
+/* Optional: to use intq_traverse, you must define a callback. */
+static void peekfun(const int *data) {
+    printf("peek: %d\n", *data);
+}
+
+int main()
+{
+    intq_t q;
+
+    /* Initialize the queue. */
+    intq_init(&q);
+
+    /* Populate the queue. */
+    for (int i = 0; i < 8; i++) {
+        if (!intq_enqueue(&q, &i))
+            printf("queue full!\n");
+    }
+
+    /* Put an item at the front of the queue. */
+    int i = 101;
+    if (!intq_enqueue_front(&q, &i))
+        printf("queue full!!\n");
+
+    /* Check queue status. */
+    printf("intq_isempty = %d\n", intq_isempty(&q));
+    printf("intq_isfull = %d\n", intq_isfull(&q));
+    printf("intq_slots_filled = %d\n", intq_slots_filled(&q));
+    printf("intq_slots_empty = %d\n", intq_slots_empty(&q));
+
+    /* Traverse the queue. */
+    intq_traverse(&q, peekfun);
+
+    /* Retrieve queue elements. */
+    while (!intq_isempty(&q)) {
+        int data;
+        if (intq_dequeue(&q, &data, true))
+            printf("data = %d\n", data);
+    }
+}
+
+#endif /*CXQ_EXAMPLE10*/
@@ -0,0 +1,141 @@
+#include "cxq.h"
+
+//#define CXQ_EXAMPLE11
+
+#ifdef CXQ_EXAMPLE11
+
+/* Same as cxq_example4.c, but elements are handed over with
+   cxq_enqueue_swap/cxq_dequeue_swap instead of being deep copied with
+   my_memcpy.  The pointer members are exchanged between the caller's
+   struct and the slot, so each hand-off costs sizeof(person_t) no
+   matter how long the strings are, and every buffer always has exactly
+   one owner.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* The data struct for the queue */
+typedef struct _person_t {
+    char *first_name;
+    char *last_name;
+    int age;
+} person_t;
+
+/* `array_len` recorded by malloc and used later.  Could have also just
+   made `slots` global.
+*/
+   
+static int array_len;
+
+/* Custom malloc function - required to create memory for
+   dynamically allocated struct elements. */
+void * my_malloc(size_t size) {
+    person_t *data = (person_t *)malloc(size);
+    array_len = size / sizeof(person_t);
+
+    for (int i = 0; i < array_len; i++) {
+        data[i].first_name = malloc(32*sizeof(char));
+        data[i].last_name = malloc(32*sizeof(char));
+    }
+    return (void *)data;
+}
+
+/* Custom free function - first free memory for struct elements,
+   then for array.
+*/
+void my_free(void *ptr) {
+    person_t *data = (person_t *)ptr;
+    for (int i = 0; i < array_len; i++) {
+        free(data[i].first_name);
+        free(data[i].last_name);
+    }
+    free(ptr);
+}
+
+/* Custom memcpy function - allows copying of each struct element
+   individually, so that pointer values aren't overwritten.
+*/
+void * my_memcpy(void *dest, const void *src, size_t n) {
+    person_t *A = (person_t *)dest;
+    person_t *B = (person_t *)src;
+
+    strcpy(A->first_name, B->first_name);
+    strcpy(A->last_name, B->last_name);
+    A->age = B->age;
+    return (void *)A;
+}
+
+/* Optional: to use cxq_traverse, you must define a callback. */
+static void peekfun(const void *data) {
+    person_t *P = (person_t *)(data);
+    printf("first_name: %s, last_name: %s, age %d\n",
+           P->first_name, P->last_name, P->age);
+}
+
+int main()
+{
+    cxq_t q;
+    int slots = 10;
+    person_t P;
+
+    /* Assign custom memory functions. */
+    memfuns_t handlers = {
+        .malloc_fn = my_malloc,
+        .free_fn = my_free,
+        .memcpy_fn = my_memcpy,
+    };
+
+    /* Initialize the queue. */
+    cxq_init(&q, slots, sizeof(person_t), &handlers);
+
+    /* The producer's struct owns a pair of buffers; each swap trades
+       them for the slot's spare pair. */
+    P.first_name = malloc(32 * sizeof(char));
+    P.last_name = malloc(32 * sizeof(char));
+
+    /* Populate the queue. */
+    printf("enqueue:\n");
+    for (int i = 0; i < 8; i++) {
+        P.age = i * 10;
+        switch (i) {
+        case 0: strcpy(P.first_name, "aaa"); strcpy(P.last_name, "AAA"); break;
+        case 1: strcpy(P.first_name, "bbb"); strcpy(P.last_name, "BBB"); break;
+        case 2: strcpy(P.first_name, "ccc"); strcpy(P.last_name, "CCC"); break;
+        case 3: strcpy(P.first_name, "ddd"); strcpy(P.last_name, "DDD"); break;
+        case 4: strcpy(P.first_name, "eee"); strcpy(P.last_name, "EEE"); break;
+        case 5: strcpy(P.first_name, "fff"); strcpy(P.last_name, "FFF"); break;
+        case 6: strcpy(P.first_name, "ggg"); strcpy(P.last_name, "GGG"); break;
+        case 7: strcpy(P.first_name, "hhh"); strcpy(P.last_name, "HHH"); break;
+        }
+
+        if (!cxq_enqueue_swap(&q, &P))
+            printf("queue full!\n");
+    }
+  
+    /* Check queue status. */
+    printf("queue_isempty = %d\n", cxq_isempty(&q));
+    printf("queue_isfull = %d\n", cxq_isfull(&q));
+    printf("queue_slots_filled = %d\n", cxq_slots_filled(&q));
+    printf("queue_slots_empty = %d\n", cxq_slots_empty(&q));
+
+    /* Traverse the queue. */
+    printf("peek:\n");
+    cxq_traverse(&q, peekfun);
+
+    /* Retrieve queue elements.  P's buffers stay behind in the slot. */
+    printf("dequeue:\n");
+    while (!cxq_isempty(&q)) {
+        if (cxq_dequeue_swap(&q, &P))
+            printf("first_name = %s, last_name = %s, age = %d\n",
+                   P.first_name, P.last_name, P.age);
+    }
+
+    /* Deinitialize the queue, and free the pair P holds. */
+    cxq_finish(&q);
+    free(P.first_name);
+    free(P.last_name);
+}
+
+#endif /*CXQ_EXAMPLE11*/
@@ -0,0 +1,127 @@
+#include "cxq.h"
+#include "cxq_arena.h"
+
+//#define CXQ_EXAMPLE12
+
+#ifdef CXQ_EXAMPLE12
+
+/* Same as cxq_example4.c, but the data array and the memory of the
+   struct elements come from a slot arena: one aligned allocation instead
+   of 2 * slots + 1 mallocs, and no custom malloc/free functions.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+/* The data struct for the queue */
+typedef struct _person_t {
+    char *first_name;
+    char *last_name;
+    int age;
+} person_t;
+
+/* Pointer members the arena fills in for every slot. */
+static const cxq_arena_member_t members[] = {
+    {offsetof(person_t, first_name), 32 * sizeof(char)},
+    {offsetof(person_t, last_name), 32 * sizeof(char)},
+};
+
+/* Custom memcpy function - allows copying of each struct element
+   individually, so that pointer values aren't overwritten.
+*/
+void * my_memcpy(void *dest, const void *src, size_t n) {
+    person_t *A = (person_t *)dest;
+    person_t *B = (person_t *)src;
+
+    strcpy(A->first_name, B->first_name);
+    strcpy(A->last_name, B->last_name);
+    A->age = B->age;
+    return (void *)A;
+}
+
+/* Optional: to use cxq_traverse, you must define a callback. */
+static void peekfun(const void *data) {
+    person_t *P = (person_t *)(data);
+    printf("first_name: %s, last_name: %s, age %d\n",
+           P->first_name, P->last_name, P->age);
+}
+
+int main()
+{
+    cxq_t q;
+    int slots = 10;
+    person_t P;
+
+    /* Describe the element layout to the arena. */
+    cxq_arena_t arena = {
+        .elem_size = sizeof(person_t),
+        .members = members,
+        .num_members = 2,
+    };
+
+    /* Custom memcpy function; the arena owns the memory. */
+    memfuns_t handlers = {
+        .memcpy_fn = my_memcpy,
+    };
+
+    /* Initialize the queue on the arena. */
+    cxq_init_arena(&q, &arena, slots, &handlers, CXQ_OPT_NONE);
+    cxq_arena_print(&arena);
+
+    /* Populate the queue. */
+    printf("enqueue:\n");
+    for (int i = 0; i < 8; i++) {
+        P.age = i * 10;
+        switch (i) {
+        case 0: P.first_name = "aaa"; P.last_name = "AAA"; break;
+        case 1: P.first_name = "bbb"; P.last_name = "BBB"; break;
+        case 2: P.first_name = "ccc"; P.last_name = "CCC"; break;
+        case 3: P.first_name = "ddd"; P.last_name = "DDD"; break;
+        case 4: P.first_name = "eee"; P.last_name = "EEE"; break;
+        case 5: P.first_name = "fff"; P.last_name = "FFF"; break;
+        case 6: P.first_name = "ggg"; P.last_name = "GGG"; break;
+        case 7: P.first_name = "hhh"; P.last_name = "HHH"; break;
+        }
+
+        if (!cxq_enqueue(&q, &P))
+            printf("queue full!\n");
+    }
+  
+    /* Put an item at the front of the queue. */
+    P.age = 101;
+    P.first_name = "farrell";
+    P.last_name = "aultman";
+    if (!cxq_enqueue_front(&q, &P))
+        printf("queue full!!\n");
+
+    /* Check queue status. */
+    printf("queue_isempty = %d\n", cxq_isempty(&q));
+    printf("queue_isfull = %d\n", cxq_isfull(&q));
+    printf("queue_slots_filled = %d\n", cxq_slots_filled(&q));
+    printf("queue_slots_empty = %d\n", cxq_slots_empty(&q));
+
+    /* Traverse the queue. */
+    printf("peek:\n");
+    cxq_traverse(&q, peekfun);
+
+    /* Allocate memory for elements in retrieve struct. */
+    P.first_name = malloc(32 * sizeof(char));
+    P.last_name = malloc(32 * sizeof(char));
+
+    /* Retrieve queue elements. */
+    printf("dequeue:\n");
+    while (!cxq_isempty(&q)) {
+        if (cxq_dequeue(&q, (void *)&P, true))
+            printf("first_name = %s, last_name = %s, age = %d\n",
+                   P.first_name, P.last_name, P.age);
+    }
+
+    /* Deinitialize the queue. */
+    cxq_finish(&q);
+    free(P.first_name);
+    free(P.last_name);
+}
+
+#endif /*CXQ_EXAMPLE12*/
@@ -0,0 +1,64 @@
+#include "cxq_rec.h"
+
+//#define CXQ_EXAMPLE13
+
+#ifdef CXQ_EXAMPLE13
+
+/* Demonstrates the variable-length record queue.  Messages of different
+   lengths are packed back to back in one byte ring, instead of each
+   taking a fixed size slot.  Records are read both by copy and in place
+   with cxq_rec_peek/cxq_rec_release.  It uses the built-in memory
+   functions.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+int main()
+{
+    cxq_rec_t q;
+    const char *msgs[] = {
+        "hi",
+        "a somewhat longer message",
+        "",
+        "the longest message of them all, by a fair margin",
+        "bye",
+    };
+    int num_msgs = sizeof(msgs) / sizeof(msgs[0]);
+
+    /* Initialize the queue with a 160 byte ring. */
+    cxq_rec_init(&q, 160, NULL);
+
+    /* Populate the queue; strings are stored with their terminator. */
+    for (int i = 0; i < num_msgs; i++) {
+        if (!cxq_rec_enqueue(&q, msgs[i], strlen(msgs[i]) + 1))
+            printf("no room for \"%s\"\n", msgs[i]);
+    }
+
+    /* Check queue status. */
+    printf("cxq_rec_get_count = %d\n", cxq_rec_get_count(&q));
+    printf("cxq_rec_bytes_used = %d\n", cxq_rec_bytes_used(&q));
+
+    /* Retrieve the first record by copy. */
+    char buf[64];
+    int len = cxq_rec_dequeue(&q, buf, sizeof(buf));
+    if (len >= 0)
+        printf("dequeue: %d bytes \"%s\"\n", len, buf);
+
+    /* Make room, then add a record that wraps to the start of the ring. */
+    cxq_rec_dequeue(&q, buf, sizeof(buf));
+    if (!cxq_rec_enqueue(&q, "wrapped", 8))
+        printf("no room for \"wrapped\"\n");
+
+    /* Retrieve the rest in place. */
+    const char *p;
+    while ((p = cxq_rec_peek(&q, &len))) {
+        printf("peek: %d bytes \"%s\"\n", len, p);
+        cxq_rec_release(&q);
+    }
+
+    /* Deinitialize the queue. */
+    cxq_rec_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE13*/
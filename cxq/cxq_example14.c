@@ -0,0 +1,84 @@
+#include "cxq_shm.h"
+
+//#define CXQ_EXAMPLE14
+
+#ifdef CXQ_EXAMPLE14
+
+/* Demonstrates a queue in POSIX shared memory, shared by two processes.
+   The parent creates the queue and produces samples in place with
+   cxq_shm_reserve/cxq_shm_commit; a forked child attaches by name and
+   consumes them in place with cxq_shm_peek/cxq_shm_release.  Elements
+   are a plain struct with no pointers.  Link with -lrt on older C
+   libraries.
+*/
+
+#include <stdio.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define QUEUE_NAME  "/cxq_example14"
+#define NUM_SAMPLES 1000
+
+typedef struct {
+    int seq;
+    double value;
+} sample_t;
+
+/* Child process - attach and consume. */
+static int consumer(void) {
+    cxq_shm_t q;
+    while (cxq_shm_attach(&q, QUEUE_NAME) < 0)
+        sched_yield();
+
+    double sum = 0;
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        sample_t *s;
+        while (!(s = cxq_shm_peek(&q)))
+            sched_yield();
+        if (s->seq != i)
+            printf("out of order: %d != %d\n", s->seq, i);
+        sum += s->value;
+        cxq_shm_release(&q);
+    }
+    printf("consumer: %d samples, sum = %.1f\n", NUM_SAMPLES, sum);
+    cxq_shm_detach(&q);
+    return 0;
+}
+
+int main()
+{
+    cxq_shm_t q;
+
+    /* Remove a segment left over from an earlier run. */
+    shm_unlink(QUEUE_NAME);
+
+    /* Create the queue before forking, so the child can attach. */
+    if (cxq_shm_create(&q, QUEUE_NAME, 64, sizeof(sample_t)) < 0) {
+        perror("cxq_shm_create");
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0)
+        return consumer();
+
+    /* Parent process - produce samples in place. */
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        sample_t *s;
+        while (!(s = cxq_shm_reserve(&q)))
+            sched_yield();
+        s->seq = i;
+        s->value = i * 0.5;
+        cxq_shm_commit(&q);
+    }
+
+    waitpid(pid, NULL, 0);
+    printf("producer: cxq_shm_isempty = %d\n", cxq_shm_isempty(&q));
+
+    /* Unmap and remove the segment. */
+    cxq_shm_detach(&q);
+}
+
+#endif /*CXQ_EXAMPLE14*/
@@ -0,0 +1,57 @@
+#include "cxq.h"
+
+//#define CXQ_EXAMPLE15
+
+#ifdef CXQ_EXAMPLE15
+
+/* Demonstrates the double-mapped ring option (CXQ_OPT_MIRROR).  The queue
+   body is mapped twice, back to back, so a run of chars that wraps past
+   the end of the ring is still one contiguous range, and cxq_peek_span
+   hands the whole queue to fwrite in one call.  This example uses the
+   primitive type char as the data.  Linux only.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+int main()
+{
+    cxq_t q;
+    const char *line1 = "the quick brown fox ";
+    const char *line2 = "jumps over the lazy dog\n";
+    char buf[64];
+    int n;
+
+    /* Initialize the queue.  Slots are rounded up to a whole page. */
+    cxq_init_ex(&q, 100, sizeof(char), NULL, CXQ_OPT_MIRROR);
+    printf("mirror = %s, slots = %d\n",
+           (q.options & CXQ_OPT_MIRROR) ? "on" : "off", cxq_get_slots(&q));
+
+    /* Move the front of the queue close to the end of the ring. */
+    int skip = cxq_get_slots(&q) - 10;
+    while (skip > 0) {
+        int chunk = skip < (int)sizeof(buf) ? skip : (int)sizeof(buf);
+        cxq_enqueue_n(&q, buf, chunk);
+        cxq_dequeue_n(&q, NULL, chunk, true);
+        skip -= chunk;
+    }
+
+    /* These chars wrap past the end of the ring. */
+    cxq_enqueue_n(&q, line1, strlen(line1));
+    cxq_enqueue_n(&q, line2, strlen(line2));
+    printf("first = %d, count = %d\n", cxq_get_first(&q), cxq_get_count(&q));
+
+    /* Write them out in one call, no copy, no split at the wrap. */
+    const char *span = cxq_peek_span(&q, &n);
+    printf("span = %d chars: ", n);
+    fwrite(span, 1, n, stdout);
+    cxq_dequeue_n(&q, NULL, n, true);
+
+    /* Check queue status. */
+    printf("cxq_isempty = %s\n", cxq_isempty(&q) ? "true" : "false");
+
+    /* Deinitialize the queue. */
+    cxq_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE15*/
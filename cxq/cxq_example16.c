@@ -0,0 +1,58 @@
+#include "cxq.h"
+
+//#define CXQ_EXAMPLE16
+
+#ifdef CXQ_EXAMPLE16
+
+/* Demonstrates the enqueue timestamp option (CXQ_OPT_TIMESTAMP).  The
+   queue records how long each element waits between enqueue and
+   dequeue, and the histogram of those times is read back at runtime.
+   This example uses the primitive type int as the data, and creates the
+   data array dynamically.  It uses the built-in memory functions.
+*/
+
+#include <stdio.h>
+#include <time.h>
+
+static void sleep_us(long us) {
+    struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+    nanosleep(&ts, NULL);
+}
+
+int main()
+{
+    cxq_t q;
+    cxq_hist_t hist;
+
+    /* Initialize the queue. */
+    cxq_init_ex(&q, 16, sizeof(int), NULL, CXQ_OPT_TIMESTAMP);
+
+    /* Let every 10th element wait about 1 ms, the rest go straight through. */
+    for (int i = 0; i < 100; i++) {
+        int data;
+        cxq_enqueue(&q, &i);
+        if (i % 10 == 0)
+            sleep_us(1000);
+        cxq_dequeue(&q, &data, true);
+    }
+
+    /* Read the histogram. */
+    cxq_get_hist(&q, &hist);
+    printf("elements = %llu, mean = %llu ns, max = %llu ns\n",
+           (unsigned long long)hist.total,
+           (unsigned long long)(hist.sum_ns / hist.total),
+           (unsigned long long)hist.max_ns);
+    for (int b = 0; b < CXQ_HIST_BUCKETS; b++) {
+        if (hist.count[b])
+            printf("  [%llu ns, %llu ns): %llu\n", 1ULL << b, 2ULL << b,
+                   (unsigned long long)hist.count[b]);
+    }
+    printf("p50 <= %llu ns, p99 <= %llu ns\n",
+           (unsigned long long)cxq_hist_percentile(&hist, 0.50),
+           (unsigned long long)cxq_hist_percentile(&hist, 0.99));
+
+    /* Deinitialize the queue. */
+    cxq_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE16*/
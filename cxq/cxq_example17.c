@@ -0,0 +1,59 @@
+#include "cxq_prio.h"
+
+//#define CXQ_EXAMPLE17
+
+#ifdef CXQ_EXAMPLE17
+
+/* Demonstrates the multi-level priority queue.  Messages are enqueued
+   at three priority levels in mixed order and come back out most urgent
+   first, in FIFO order within each level.  This example uses a simple
+   struct as the data, and creates the data arrays dynamically.  It uses
+   the built-in memory functions.
+*/
+
+#include <stdio.h>
+
+typedef struct {
+    int id;
+    char text[16];
+} msg_t;
+
+enum {URGENT, NORMAL, BACKGROUND, NUM_LEVELS};
+
+int main()
+{
+    cxq_prio_t q;
+    msg_t msgs[] = {
+        {1, "log rotate"},
+        {2, "user input"},
+        {3, "alarm"},
+        {4, "redraw"},
+        {5, "overheat"},
+        {6, "gc"},
+    };
+    int levels[] = {BACKGROUND, NORMAL, URGENT, NORMAL, URGENT, BACKGROUND};
+    int num_msgs = sizeof(msgs) / sizeof(msgs[0]);
+
+    /* Initialize the queue, 4 slots per level. */
+    cxq_prio_init(&q, NUM_LEVELS, 4, sizeof(msg_t), NULL);
+
+    /* Populate the queue. */
+    for (int i = 0; i < num_msgs; i++)
+        cxq_prio_enqueue(&q, &msgs[i], levels[i]);
+
+    /* Check queue status. */
+    printf("cxq_prio_get_count = %d\n", cxq_prio_get_count(&q));
+    for (int i = 0; i < NUM_LEVELS; i++)
+        printf("  level %d: %d\n", i, cxq_prio_get_level_count(&q, i));
+
+    /* Retrieve in priority order. */
+    msg_t msg;
+    int prio;
+    while (cxq_prio_dequeue(&q, &msg, &prio))
+        printf("prio %d: msg %d \"%s\"\n", prio, msg.id, msg.text);
+
+    /* Deinitialize the queue. */
+    cxq_prio_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE17*/
@@ -0,0 +1,51 @@
+#include "cxq.h"
+
+//#define CXQ_EXAMPLE18
+
+#ifdef CXQ_EXAMPLE18
+
+/* Demonstrates a growable queue.  A burst of 100 ints is enqueued into
+   a queue that starts with 8 slots and may grow to 128, so the body
+   doubles as it fills instead of rejecting elements.  Once the burst is
+   drained and traffic is light again, the body shrinks back towards its
+   initial size.  It uses the built-in memory functions.
+*/
+
+#include <stdio.h>
+
+int main()
+{
+    cxq_t q;
+    int val;
+
+    /* Initialize the queue, 8 slots, growing up to 128. */
+    cxq_init(&q, 8, sizeof(int), NULL);
+    cxq_set_growth(&q, 128);
+
+    /* A burst that overruns the initial size. */
+    for (int i = 0; i < 100; i++) {
+        if (!cxq_enqueue(&q, &i))
+            printf("enqueue %d failed\n", i);
+        if (i == 7 || i == 8 || i == 16 || i == 32 || i == 64)
+            printf("count %3d, slots %3d\n", cxq_get_count(&q),
+                   cxq_get_slots(&q));
+    }
+
+    /* Elements come back in order across the resizes. */
+    int sum = 0;
+    while (cxq_dequeue(&q, &val, true))
+        sum += val;
+    printf("drained, sum = %d, slots %d\n", sum, cxq_get_slots(&q));
+
+    /* Light traffic, one element in flight at a time. */
+    for (int i = 0; i < 500; i++) {
+        cxq_enqueue(&q, &i);
+        cxq_dequeue(&q, &val, true);
+    }
+    printf("after light traffic, slots %d\n", cxq_get_slots(&q));
+
+    /* Deinitialize the queue. */
+    cxq_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE18*/
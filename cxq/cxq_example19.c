@@ -0,0 +1,55 @@
+#include "cxq_seg.h"
+
+//#define CXQ_EXAMPLE19
+
+#ifdef CXQ_EXAMPLE19
+
+/* Demonstrates the unbounded segmented queue.  A burst of 1000 ints is
+   enqueued into a queue of 64-slot segments, which links new segments
+   as it fills without ever copying an element.  As the burst drains,
+   up to 4 segments are kept for reuse and the rest are freed.  Steady
+   traffic afterwards reuses the kept segments without allocating.  It
+   uses the built-in memory functions.
+*/
+
+#include <stdio.h>
+
+int main()
+{
+    cxq_seg_t q;
+    int val;
+
+    /* Initialize the queue, 64 slots per segment, keep 4 spare. */
+    cxq_seg_init(&q, 64, sizeof(int), NULL, 4);
+
+    /* A burst. */
+    for (int i = 0; i < 1000; i++)
+        cxq_seg_enqueue(&q, &i);
+    printf("burst: count %d, segments %d, spare %d\n", cxq_seg_get_count(&q),
+           cxq_seg_get_segments(&q), cxq_seg_get_spare(&q));
+
+    /* Drain it. */
+    int sum = 0;
+    while (cxq_seg_dequeue(&q, &val))
+        sum += val;
+    printf("drained: sum %d, segments %d, spare %d\n", sum,
+           cxq_seg_get_segments(&q), cxq_seg_get_spare(&q));
+
+    /* Steady traffic with a backlog of about 200 reuses the spares. */
+    for (int i = 0; i < 10000; i++) {
+        cxq_seg_enqueue(&q, &i);
+        if (i >= 200)
+            cxq_seg_dequeue(&q, &val);
+    }
+    printf("steady: count %d, segments %d, spare %d\n", cxq_seg_get_count(&q),
+           cxq_seg_get_segments(&q), cxq_seg_get_spare(&q));
+
+    /* Give the spares back. */
+    cxq_seg_trim(&q, 0);
+    printf("trimmed: spare %d\n", cxq_seg_get_spare(&q));
+
+    /* Deinitialize the queue. */
+    cxq_seg_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE19*/
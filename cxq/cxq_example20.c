@@ -0,0 +1,94 @@
+#include "cxq.h"
+
+//#define CXQ_EXAMPLE20
+
+#ifdef CXQ_EXAMPLE20
+
+/* Demonstrates waiting for a queue in an epoll loop with
+   CXQ_OPT_EVENTFD.  A producer thread enqueues ints in bursts into a
+   lock-free SPSC queue; the consumer waits in epoll_wait on the queue's
+   eventfd alongside a timerfd, as it would alongside sockets.  The fd
+   is only signaled when the queue goes from empty to not empty, so
+   there are far fewer wakeups than elements.  Linux only; build with
+   -pthread.
+*/
+
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#define NUM_ITEMS   10000
+#define BURST       100
+
+static cxq_t q;
+
+/* Producer thread - bursts of BURST ints, a short pause between. */
+static void * producer(void *arg) {
+    for (int i = 0; i < NUM_ITEMS; i++) {
+        while (!cxq_enqueue(&q, &i))
+            ;
+        if (i % BURST == BURST - 1)
+            usleep(100);
+    }
+    return NULL;
+}
+
+int main()
+{
+    pthread_t tid;
+    struct epoll_event ev, events[2];
+    int got = 0, wakeups = 0, ticks = 0;
+    long sum = 0;
+
+    /* Initialize the queue, with an eventfd for the consumer. */
+    cxq_init_ex(&q, 1024, sizeof(int), NULL, CXQ_OPT_SPSC | CXQ_OPT_EVENTFD);
+
+    /* Wait on the queue and a 1 ms timer. */
+    int ep = epoll_create1(0);
+    int qfd = cxq_get_fd(&q);
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    struct itimerspec its = {{0, 1000000}, {0, 1000000}};
+    timerfd_settime(tfd, 0, &its, NULL);
+    ev.events = EPOLLIN;
+    ev.data.fd = qfd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, qfd, &ev);
+    ev.data.fd = tfd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev);
+
+    pthread_create(&tid, NULL, producer, NULL);
+    while (got < NUM_ITEMS) {
+        int n = epoll_wait(ep, events, 2, -1);
+        for (int i = 0; i < n; i++) {
+            uint64_t counter;
+            /* Clear the fd, then drain. */
+            if (read(events[i].data.fd, &counter, sizeof(counter)) < 0)
+                continue;
+            if (events[i].data.fd == tfd) {
+                ticks++;
+                continue;
+            }
+            wakeups++;
+            int val;
+            while (cxq_dequeue(&q, &val, true)) {
+                sum += val;
+                got++;
+            }
+        }
+    }
+    pthread_join(tid, NULL);
+
+    printf("received %d ints, sum %s\n", got,
+           (sum == (long)NUM_ITEMS * (NUM_ITEMS - 1) / 2) ? "ok" : "wrong");
+    printf("%s\n", (wakeups < got) ? "fewer wakeups than elements"
+                                   : "a wakeup per element");
+    printf("timer ticks seen: %s\n", ticks ? "yes" : "no");
+
+    /* Deinitialize the queue. */
+    close(tfd);
+    close(ep);
+    cxq_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE20*/
@@ -0,0 +1,58 @@
+#include "cxq_set.h"
+
+//#define CXQ_EXAMPLE21
+
+#ifdef CXQ_EXAMPLE21
+
+/* Demonstrates waiting on many queues at once with cxq_set_t.  One
+   queue per device is added to a set; a few devices post readings, and
+   a single cxq_set_wait returns the bitmap of queues with data, which
+   is walked with cxq_set_next.  Only the ready queues are visited.  It
+   uses the built-in memory functions.
+*/
+
+#include <stdio.h>
+
+#define NUM_DEVICES 40
+
+int main()
+{
+    cxq_t devices[NUM_DEVICES];
+    cxq_set_t set;
+
+    /* Initialize the queues and the set. */
+    cxq_set_init(&set);
+    for (int i = 0; i < NUM_DEVICES; i++) {
+        cxq_init(&devices[i], 8, sizeof(int), NULL);
+        cxq_set_add(&set, &devices[i]);
+    }
+
+    /* A few devices post readings. */
+    int posting[] = {3, 17, 3, 38, 17, 3};
+    for (size_t i = 0; i < sizeof(posting) / sizeof(posting[0]); i++) {
+        int reading = 100 * posting[i] + (int)i;
+        cxq_enqueue(&devices[posting[i]], &reading);
+    }
+
+    /* Wait once, then visit only the ready queues. */
+    uint64_t ready = cxq_set_wait(&set, 10);
+    int index, reading;
+    while ((index = cxq_set_next(&ready)) >= 0) {
+        cxq_t *q = cxq_set_get(&set, index);
+        printf("device %d:", index);
+        while (cxq_dequeue(q, &reading, true))
+            printf(" %d", reading);
+        printf("\n");
+    }
+
+    /* Nothing is ready now. */
+    printf("cxq_set_wait = %llu\n",
+           (unsigned long long)cxq_set_wait(&set, 0));
+
+    /* Deinitialize the set and the queues. */
+    cxq_set_finish(&set);
+    for (int i = 0; i < NUM_DEVICES; i++)
+        cxq_finish(&devices[i]);
+}
+
+#endif /*CXQ_EXAMPLE21*/
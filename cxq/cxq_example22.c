@@ -0,0 +1,74 @@
+#include "cxq_bcast.h"
+
+//#define CXQ_EXAMPLE22
+
+#ifdef CXQ_EXAMPLE22
+
+/* Demonstrates the broadcast ring.  Samples are written once and read
+   by a logger, a controller and a UI, each through its own cursor.  In
+   lossless mode the writer stops when the slowest reader is `slots`
+   behind; in circular mode it keeps going and the slow UI reader is
+   told how many samples it lost.  The UI detaches and reattaches at
+   runtime.  It uses the built-in memory functions.
+*/
+
+#include <stdio.h>
+
+int main()
+{
+    cxq_bcast_t q;
+    int sample, lost;
+
+    /* Initialize the ring, 4 slots, and attach three readers. */
+    cxq_bcast_init(&q, 4, sizeof(int), NULL);
+    int logger = cxq_bcast_attach(&q);
+    int control = cxq_bcast_attach(&q);
+    int ui = cxq_bcast_attach(&q);
+
+    /* Lossless: the writer is held back by the readers. */
+    int written = 0;
+    for (int i = 0; i < 6; i++)
+        if (cxq_bcast_enqueue(&q, &i))
+            written++;
+    printf("lossless: wrote %d of 6, cxq_bcast_isfull = %d\n", written,
+           cxq_bcast_isfull(&q));
+
+    /* Every reader sees every sample. */
+    const char *names[] = {"logger", "control", "ui"};
+    int readers[] = {logger, control, ui};
+    for (int r = 0; r < 3; r++) {
+        printf("%-8s:", names[r]);
+        while (cxq_bcast_dequeue(&q, readers[r], &sample, NULL))
+            printf(" %d", sample);
+        printf("\n");
+    }
+
+    /* Circular: the UI stops reading and gets overrun. */
+    cxq_bcast_set_circular(&q);
+    for (int i = 10; i < 20; i++) {
+        cxq_bcast_enqueue(&q, &i);
+        cxq_bcast_dequeue(&q, logger, &sample, NULL);
+        cxq_bcast_dequeue(&q, control, &sample, NULL);
+    }
+    printf("ui      :");
+    while (cxq_bcast_dequeue(&q, ui, &sample, &lost)) {
+        if (lost)
+            printf(" (lost %d)", lost);
+        printf(" %d", sample);
+    }
+    printf("\n");
+
+    /* The UI detaches, then reattaches and only sees new samples. */
+    cxq_bcast_detach(&q, ui);
+    sample = 99;
+    cxq_bcast_enqueue(&q, &sample);
+    ui = cxq_bcast_attach(&q);
+    sample = 100;
+    cxq_bcast_enqueue(&q, &sample);
+    printf("ui after reattach: %d to read\n", cxq_bcast_get_count(&q, ui));
+
+    /* Deinitialize the ring. */
+    cxq_bcast_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE22*/
@@ -0,0 +1,75 @@
+#include "cxq_pool.h"
+
+//#define CXQ_EXAMPLE23
+
+#ifdef CXQ_EXAMPLE23
+
+/* Demonstrates the work-stealing task pool with a fork/join parallel
+   sum.  A task splits its range in two, spawns a child task for one
+   half, sums the other half itself, then joins the child with
+   cxq_pool_wait, running other tasks meanwhile.  Idle workers steal the
+   oldest, biggest halves.  POSIX only; build with -pthread.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_VALUES  (1 << 20)
+#define CUTOFF      4096
+
+static cxq_pool_t pool;
+static int *values;
+
+typedef struct {
+    int lo, hi;             /* Range to sum. */
+    long long sum;          /* Result. */
+    atomic_int *pending;    /* Parent's join counter. */
+} range_t;
+
+static void sum_task(void *arg) {
+    range_t *r = arg;
+    if (r->hi - r->lo <= CUTOFF) {
+        r->sum = 0;
+        for (int i = r->lo; i < r->hi; i++)
+            r->sum += values[i];
+    } else {
+        /* Fork the upper half, do the lower half, then join. */
+        int mid = r->lo + (r->hi - r->lo) / 2;
+        atomic_int pending = 1;
+        range_t upper = {mid, r->hi, 0, &pending};
+        range_t lower = {r->lo, mid, 0, NULL};
+        cxq_pool_submit(&pool, sum_task, &upper);
+        sum_task(&lower);
+        cxq_pool_wait(&pool, &pending);
+        r->sum = lower.sum + upper.sum;
+    }
+    if (r->pending)
+        atomic_fetch_sub(r->pending, 1);
+}
+
+int main()
+{
+    values = malloc(NUM_VALUES * sizeof(int));
+    for (int i = 0; i < NUM_VALUES; i++)
+        values[i] = i % 1000;
+
+    /* Start 4 workers with 256-slot deques. */
+    cxq_pool_init(&pool, 4, 256);
+
+    /* Submit the root task from outside the pool and join it. */
+    atomic_int pending = 1;
+    range_t root = {0, NUM_VALUES, 0, &pending};
+    cxq_pool_submit(&pool, sum_task, &root);
+    cxq_pool_wait(&pool, &pending);
+
+    long long expect = 0;
+    for (int i = 0; i < NUM_VALUES; i++)
+        expect += values[i];
+    printf("sum = %lld, %s\n", root.sum, root.sum == expect ? "ok" : "wrong");
+
+    /* Stop the workers. */
+    cxq_pool_finish(&pool);
+    free(values);
+}
+
+#endif /*CXQ_EXAMPLE23*/
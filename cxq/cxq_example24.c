@@ -0,0 +1,46 @@
+#include "cxq_shard.h"
+
+//#define CXQ_EXAMPLE24
+
+#ifdef CXQ_EXAMPLE24
+
+/* Demonstrates the sharded queue.  Three producers, played here by one
+   thread switching its home shard with cxq_shard_set_home, each enqueue
+   to their own shard.  A consumer at home on shard 1 drains its own
+   shard first, then steals from the others; elements stay in order
+   within each shard.  In a real program each producer thread keeps its
+   home and MULTI_THREAD is defined.  It uses the built-in memory
+   functions.
+*/
+
+#include <stdio.h>
+
+int main()
+{
+    cxq_shard_t q;
+    int val;
+
+    /* Initialize the queue, 3 shards of 8 slots. */
+    cxq_shard_init(&q, 3, 8, sizeof(int), NULL, CXQ_SHARD_NONE);
+
+    /* Producer p enqueues p*100+i to shard p. */
+    for (int p = 0; p < 3; p++) {
+        cxq_shard_set_home(p);
+        for (int i = 0; i < 3; i++) {
+            val = p * 100 + i;
+            cxq_shard_enqueue(&q, &val);
+        }
+    }
+    printf("cxq_shard_get_count = %d\n", cxq_shard_get_count(&q));
+
+    /* Consumer at home on shard 1. */
+    cxq_shard_set_home(1);
+    while (cxq_shard_dequeue(&q, &val, true))
+        printf("%d ", val);
+    printf("\n");
+
+    /* Deinitialize the queue. */
+    cxq_shard_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE24*/
@@ -0,0 +1,70 @@
+#include "cxq_par.h"
+
+//#define CXQ_EXAMPLE25
+
+#ifdef CXQ_EXAMPLE25
+
+/* Demonstrates span and parallel traversal.  A queue of ints is filled
+   so that its elements wrap around the end of the ring, then summed
+   with cxq_traverse_spans, which gets the two ranges either side of the
+   wrap, and with cxq_traverse_parallel on 4 threads, each summing its
+   share and the shares added up at the end.  Nothing touches the queue
+   while it's traversed.  It uses the built-in memory functions.  Build
+   with -pthread.
+*/
+
+#include <stdio.h>
+
+#define SLOTS   1000
+
+/* Add up n ints into the long at arg. */
+static void sum_span(const void *data, int n, int stride, void *arg) {
+    long *sum = arg;
+    const char *p = data;
+    for (int i = 0; i < n; i++, p += stride)
+        *sum += *(const int *)p;
+}
+
+static void add(void *result, const void *partial) {
+    *(long *)result += *(const long *)partial;
+}
+
+int main()
+{
+    cxq_t q;
+    cxq_span_t span[2];
+    long expect = 0, sum;
+    int val;
+
+    /* Initialize the queue, move the start past the middle of the ring,
+       then fill it with 1..SLOTS. */
+    cxq_init(&q, SLOTS, sizeof(int), NULL);
+    for (int i = 0; i < SLOTS * 3 / 4; i++) {
+        cxq_enqueue(&q, &i);
+        cxq_dequeue(&q, &val, true);
+    }
+    for (int i = 1; i <= SLOTS; i++) {
+        cxq_enqueue(&q, &i);
+        expect += i;
+    }
+
+    int spans = cxq_get_spans(&q, span);
+    printf("%d spans:", spans);
+    for (int i = 0; i < spans; i++)
+        printf(" %d", span[i].n);
+    printf("\n");
+
+    sum = 0;
+    cxq_traverse_spans(&q, sum_span, &sum);
+    printf("cxq_traverse_spans sum = %ld (expect %ld)\n", sum, expect);
+
+    sum = 0;
+    int n = cxq_traverse_parallel(&q, 4, sum_span, add, &sum, sizeof(sum));
+    printf("cxq_traverse_parallel sum = %ld over %d elements (expect %ld)\n",
+           sum, n, expect);
+
+    /* Deinitialize the queue. */
+    cxq_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE25*/
@@ -6,8 +6,9 @@
 
 /* This example uses a complex struct type as the data, and creates
    the data array dynamically, as well as the memory of some of the struct
-   elements.  It uses custom memory functions.  Data is dequeued by pointer
-   instead of by data copy.
+   elements.  It uses custom memory functions.  Data is enqueued in place
+   with cxq_reserve/cxq_commit, and dequeued by pointer with
+   cxq_peek/cxq_release, instead of by data copy.
 */
 
 #include <stdio.h>
@@ -90,23 +91,26 @@ int main()
     /* Initialize the queue. */
     cxq_init(&q, slots, sizeof(person_t), &handlers);
 
-    /* Populate the queue. */
+    /* Populate the queue, filling each slot in place. */
     printf("enqueue:\n");
     for (int i = 0; i < 8; i++) {
-        P.age = i * 10;
+        person_t *p = (person_t *)cxq_reserve(&q);
+        if (!p) {
+            printf("queue full!\n");
+            continue;
+        }
+        p->age = i * 10;
         switch (i) {
-        case 0: P.first_name = "aaa"; P.last_name = "AAA"; break;
-        case 1: P.first_name = "bbb"; P.last_name = "BBB"; break;
-        case 2: P.first_name = "ccc"; P.last_name = "CCC"; break;
-        case 3: P.first_name = "ddd"; P.last_name = "DDD"; break;
-        case 4: P.first_name = "eee"; P.last_name = "EEE"; break;
-        case 5: P.first_name = "fff"; P.last_name = "FFF"; break;
-        case 6: P.first_name = "ggg"; P.last_name = "GGG"; break;
-        case 7: P.first_name = "hhh"; P.last_name = "HHH"; break;
+        case 0: strcpy(p->first_name, "aaa"); strcpy(p->last_name, "AAA"); break;
+        case 1: strcpy(p->first_name, "bbb"); strcpy(p->last_name, "BBB"); break;
+        case 2: strcpy(p->first_name, "ccc"); strcpy(p->last_name, "CCC"); break;
+        case 3: strcpy(p->first_name, "ddd"); strcpy(p->last_name, "DDD"); break;
+        case 4: strcpy(p->first_name, "eee"); strcpy(p->last_name, "EEE"); break;
+        case 5: strcpy(p->first_name, "fff"); strcpy(p->last_name, "FFF"); break;
+        case 6: strcpy(p->first_name, "ggg"); strcpy(p->last_name, "GGG"); break;
+        case 7: strcpy(p->first_name, "hhh"); strcpy(p->last_name, "HHH"); break;
         }
-
-        if (!cxq_enqueue(&q, &P))
-            printf("queue full!\n");
+        cxq_commit(&q);
     }
   
     /* Put an item at the front of the queue. */
@@ -126,17 +130,15 @@ int main()
     printf("peek:\n");
     cxq_traverse(&q, peekfun);
 
-    /* Allocate memory for elements in retrieve struct. */
-    P.first_name = malloc(32 * sizeof(char));
-    P.last_name = malloc(32 * sizeof(char));
-
-    /* Retrieve queue elements. */
+    /* Retrieve queue elements.  The pointer stays valid until
+       cxq_release, even if a producer runs in between. */
     printf("dequeue:\n");
     while (!cxq_isempty(&q)) {
-        person_t *p = (person_t *)cxq_dequeue(&q, NULL, true);
+        person_t *p = (person_t *)cxq_peek(&q);
         if (p) {
             printf("first_name = %s, last_name = %s, age = %d\n",
                    p->first_name, p->last_name, p->age);
+            cxq_release(&q);
         }
     }
 
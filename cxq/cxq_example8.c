@@ -0,0 +1,77 @@
+#include "cxq.h"
+
+//#define CXQ_EXAMPLE8
+
+#ifdef CXQ_EXAMPLE8
+
+/* Demonstrates the lock-free single producer/single consumer option.
+   One thread enqueues, another dequeues, and no lock is taken.  This
+   example uses the primitive type int as the data, and creates the
+   data array dynamically.  It uses the built-in memory functions.
+   Build with -pthread.
+*/
+
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define NUM_ITEMS 100000
+
+static cxq_t q;
+
+/* Producer thread - enqueue 0..NUM_ITEMS-1, retrying while full. */
+static void * producer(void *arg) {
+    for (int i = 0; i < NUM_ITEMS; i++) {
+        while (!cxq_enqueue(&q, &i))
+            sched_yield();
+    }
+    return NULL;
+}
+
+/* Consumer thread - dequeue and check the sequence. */
+static void * consumer(void *arg) {
+    long long sum = 0;
+    int expected = 0;
+    while (expected < NUM_ITEMS) {
+        int data;
+        if (cxq_dequeue(&q, &data, true)) {
+            if (data != expected)
+                printf("out of order: %d != %d\n", data, expected);
+            sum += data;
+            expected++;
+        } else {
+            sched_yield();
+        }
+    }
+    printf("consumed %d items, sum = %lld\n", expected, sum);
+    return NULL;
+}
+
+int main()
+{
+    pthread_t prod, cons;
+    int slots = 100;
+
+    /* Initialize the queue in lock-free SPSC mode. */
+    cxq_init_ex(&q, slots, sizeof(int), NULL, CXQ_OPT_SPSC);
+
+    /* Run producer and consumer concurrently. */
+    pthread_create(&cons, NULL, consumer, NULL);
+    pthread_create(&prod, NULL, producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+
+    /* Check queue status. */
+    printf("cxq_isempty = %d\n", cxq_isempty(&q));
+    printf("cxq_slots_filled = %d\n", cxq_slots_filled(&q));
+
+    /* Front insertion is not allowed in SPSC mode. */
+    int i = 101;
+    if (!cxq_enqueue_front(&q, &i))
+        printf("enqueue_front not allowed in SPSC mode\n");
+
+    /* Deinitialize the queue. */
+    cxq_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE8*/
@@ -0,0 +1,67 @@
+#include "cxq.h"
+
+//#define CXQ_EXAMPLE9
+
+#ifdef CXQ_EXAMPLE9
+
+/* Demonstrates blocking enqueue/dequeue on the POSIX backend.  The
+   consumer parks in cxq_dequeue_wait instead of polling cxq_isempty,
+   and the producer parks in cxq_enqueue_wait while the queue is full.
+   This example uses the primitive type int as the data, and creates
+   the data array dynamically.  It uses the built-in memory functions.
+   Build with -DMULTI_THREAD -DCXQ_POSIX -pthread.
+*/
+
+#if !defined(MULTI_THREAD) || !defined(CXQ_POSIX)
+#error "cxq_example9 requires MULTI_THREAD and CXQ_POSIX"
+#endif
+
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define NUM_ITEMS 20
+
+static cxq_t q;
+
+/* Producer thread - enqueue in bursts, with pauses in between. */
+static void * producer(void *arg) {
+    for (int i = 0; i < NUM_ITEMS; i++) {
+        if (!cxq_enqueue_wait(&q, &i, CXQ_WAIT_FOREVER))
+            printf("enqueue_wait failed!\n");
+        if (i % 5 == 4)
+            usleep(50000);
+    }
+    return NULL;
+}
+
+int main()
+{
+    pthread_t prod;
+    int slots = 4;
+
+    /* Initialize the queue. */
+    cxq_init(&q, slots, sizeof(int), NULL);
+
+    pthread_create(&prod, NULL, producer, NULL);
+
+    /* Retrieve queue elements, sleeping while the queue is empty. */
+    for (int i = 0; i < NUM_ITEMS; i++) {
+        int data;
+        if (cxq_dequeue_wait(&q, &data, 1000))
+            printf("data = %d\n", data);
+        else
+            printf("timeout!\n");
+    }
+    pthread_join(prod, NULL);
+
+    /* Nothing left, so this times out. */
+    int data;
+    if (!cxq_dequeue_wait(&q, &data, 100))
+        printf("timeout after 100 ms\n");
+
+    /* Deinitialize the queue. */
+    cxq_finish(&q);
+}
+
+#endif /*CXQ_EXAMPLE9*/
@@ -0,0 +1,184 @@
+/******************************************************************************
+
+ cxq_mpmc.c - bounded lock-free multi-producer/multi-consumer queue
+
+ Based on Dmitry Vyukov's bounded MPMC queue.  Each slot carries a
+ sequence number, so a producer only contends with other producers on
+ `enqueue_pos`, and a consumer only with other consumers on `dequeue_pos`.
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cxq_mpmc.h"
+
+
+/*
+  Description
+    Init the queue.
+
+  Parameters
+    q          - Pointer to cxq_mpmc_t struct.
+    slots      - Number of queue positions, rounded up to a power of two
+                 and at least 2.  With one slot the sequence numbers of
+                 a free and a full slot would be the same.
+    data_size  - The size of each queue element.
+    handlers   - Pointer to memfuns_t stuct that manages memory allocation
+                 for queue elements, same as for cxq_init.
+
+  Returns
+    None
+*/
+void cxq_mpmc_init(cxq_mpmc_t *q, int slots, int data_size,
+                   memfuns_t *handlers) {
+    q->slots = cxq_pow2_roundup(slots < 2 ? 2 : slots);
+    q->mask = q->slots - 1;
+    q->data_size = data_size;
+    q->handlers = malloc(sizeof(memfuns_t));
+    if (handlers) {
+        q->handlers->malloc_fn = handlers->malloc_fn;
+        q->handlers->free_fn = handlers->free_fn;
+        q->handlers->memcpy_fn = handlers->memcpy_fn;
+        q->handlers->move_fn = handlers->move_fn;
+        q->handlers->swap_fn = handlers->swap_fn;
+    } else {
+        /* Default handlers. */
+        q->handlers->malloc_fn = malloc;
+        q->handlers->free_fn = free;
+        q->handlers->memcpy_fn = memcpy;
+        q->handlers->move_fn = NULL;
+        q->handlers->swap_fn = NULL;
+    }
+    if (q->handlers->malloc_fn)
+        q->data = q->handlers->malloc_fn(q->slots * data_size);
+    q->seq = malloc(q->slots * sizeof(atomic_uint));
+    for (int i = 0; i < q->slots; i++)
+        atomic_init(&q->seq[i], i);
+    atomic_init(&q->enqueue_pos, 0);
+    atomic_init(&q->dequeue_pos, 0);
+}
+
+
+/*
+  Description
+    De-init queue, free memory.
+
+  Parameters
+    q          - Pointer to cxq_mpmc_t struct.
+
+  Returns
+    None
+*/
+void cxq_mpmc_finish(cxq_mpmc_t *q) {
+    if (q->handlers->free_fn)
+        q->handlers->free_fn(q->data);
+    free(q->seq);
+    free(q->handlers);
+}
+
+
+/*
+  Description
+    Add an element to end of queue.  Safe to call from any number of
+    producer threads.
+
+  Parameters
+    q          - Pointer to cxq_mpmc_t struct.
+    data       - Pointer to source memory for enqueued element.
+
+  Returns
+    true on success, false if the queue is full.
+*/
+bool cxq_mpmc_enqueue(cxq_mpmc_t *q, const void *data) {
+    unsigned pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+    atomic_uint *seq;
+    for (;;) {
+        seq = &q->seq[pos & q->mask];
+        int diff = (int)(atomic_load_explicit(seq, memory_order_acquire) - pos);
+        if (diff == 0) {
+            /* Slot is free, try to claim it. */
+            if (atomic_compare_exchange_weak_explicit(&q->enqueue_pos, &pos,
+                    pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            /* Slot still holds data from the previous lap, queue full. */
+            return false;
+        } else {
+            /* Another producer got here first. */
+            pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    if (q->handlers->memcpy_fn)
+        q->handlers->memcpy_fn(q->data + (pos & q->mask) * q->data_size,
+                               data, q->data_size);
+    atomic_store_explicit(seq, pos + 1, memory_order_release);
+    return true;
+}
+
+
+/*
+  Description
+    Remove an element from front of queue.  Safe to call from any number
+    of consumer threads.
+
+  Parameters
+    q          - Pointer to cxq_mpmc_t struct.
+    data       - Pointer to destination memory for dequeued element,
+                 allocated by the caller.
+
+  Returns
+    true on success, false if the queue is empty.
+*/
+bool cxq_mpmc_dequeue(cxq_mpmc_t *q, void *data) {
+    unsigned pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+    atomic_uint *seq;
+    for (;;) {
+        seq = &q->seq[pos & q->mask];
+        int diff = (int)(atomic_load_explicit(seq, memory_order_acquire)
+                         - (pos + 1));
+        if (diff == 0) {
+            /* Slot holds data, try to claim it. */
+            if (atomic_compare_exchange_weak_explicit(&q->dequeue_pos, &pos,
+                    pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            /* Slot not yet written, queue empty. */
+            return false;
+        } else {
+            /* Another consumer got here first. */
+            pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+        }
+    }
+    if (q->handlers->memcpy_fn)
+        q->handlers->memcpy_fn(data, q->data + (pos & q->mask) * q->data_size,
+                               q->data_size);
+    /* Hand the slot back to producers for the next lap. */
+    atomic_store_explicit(seq, pos + q->mask + 1, memory_order_release);
+    return true;
+}
+
+
+/* Returns num of elements in queue.  Only a snapshot when other threads
+   are active. */
+int cxq_mpmc_get_count(cxq_mpmc_t *q) {
+    unsigned head = atomic_load_explicit(&q->dequeue_pos, memory_order_acquire);
+    unsigned tail = atomic_load_explicit(&q->enqueue_pos, memory_order_acquire);
+    int n = (int)(tail - head);
+    if (n < 0) return 0;
+    return (n > q->slots) ? q->slots : n;
+}
+
+
+/* Returns number of data slots. */
+int cxq_mpmc_get_slots(const cxq_mpmc_t *q) {return q->slots;}
+
+
+/* Returns true if queue is empty. */
+bool cxq_mpmc_isempty(cxq_mpmc_t *q) {return cxq_mpmc_get_count(q) <= 0;}
+
+
+/* Returns true if queue is full. */
+bool cxq_mpmc_isfull(cxq_mpmc_t *q) {
+    return cxq_mpmc_get_count(q) >= q->slots;
+}
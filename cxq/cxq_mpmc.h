@@ -0,0 +1,50 @@
+/******************************************************************************
+
+ cxq_mpmc.h
+
+*******************************************************************************/
+
+#ifndef CXQ_MPMC_H
+#define CXQ_MPMC_H
+
+#include <stdatomic.h>
+
+#include "cxq.h"
+
+/* One sequence number per slot.  A slot at position `pos` is free for
+   the producer when seq == pos, and holds data for the consumer when
+   seq == pos + 1.  The two positions are padded a cache line apart,
+   and from the rest, without over-aligning the struct, so it can be
+   malloc'd.
+*/
+typedef struct {
+    void *data;             /* Pointer to body of queue. */
+    atomic_uint *seq;       /* Per-slot sequence numbers. */
+    unsigned mask;          /* slots - 1, slots is a power of two. */
+    int slots;              /* Num of queue slots. */
+    int data_size;          /* Size of each queue element. */
+    memfuns_t *handlers;    /* Memory callback functions. */
+    char pad0[CXQ_CACHE_LINE];
+    atomic_uint enqueue_pos;    /* Producers. */
+    char pad1[CXQ_CACHE_LINE - sizeof(atomic_uint)];
+    atomic_uint dequeue_pos;    /* Consumers. */
+    char pad2[CXQ_CACHE_LINE - sizeof(atomic_uint)];
+} cxq_mpmc_t;
+
+/* construction/destruction */
+void cxq_mpmc_init(cxq_mpmc_t *q, int slots, int data_size,
+                   memfuns_t *handlers);
+void cxq_mpmc_finish(cxq_mpmc_t *q);
+
+/* enqueue/dequeue */
+bool cxq_mpmc_enqueue(cxq_mpmc_t *q, const void *data);
+bool cxq_mpmc_dequeue(cxq_mpmc_t *q, void *data);
+
+/* get/isempty/isfull */
+int cxq_mpmc_get_count(cxq_mpmc_t *q);
+int cxq_mpmc_get_slots(const cxq_mpmc_t *q);
+bool cxq_mpmc_isempty(cxq_mpmc_t *q);
+bool cxq_mpmc_isfull(cxq_mpmc_t *q);
+
+
+#endif /* CXQ_MPMC_H */
@@ -0,0 +1,126 @@
+#include "cxq.h"
+#include "cxq_mpmc.h"
+
+//#define CXQ_MPMC_BENCH
+
+#ifdef CXQ_MPMC_BENCH
+
+/* Compares cxq_mpmc_t against a cxq_t guarded by one mutex: q->lock in
+   MULTI_THREAD builds, otherwise a pthread mutex taken around each call
+   the same way.  For each thread count 1..N, N producers and N
+   consumers move ITEMS ints through the queue.
+   Build with -pthread.  Usage: ./a.out [max_threads]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define ITEMS   (1 << 20)
+#define SLOTS   1024
+
+static cxq_mpmc_t mq;
+static cxq_t lq;
+#ifndef MULTI_THREAD
+static pthread_mutex_t lq_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static int per_thread;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* The queue guards itself in MULTI_THREAD builds. */
+static void lq_lock_acquire(void) {
+#ifndef MULTI_THREAD
+    pthread_mutex_lock(&lq_lock);
+#endif
+}
+
+static void lq_lock_release(void) {
+#ifndef MULTI_THREAD
+    pthread_mutex_unlock(&lq_lock);
+#endif
+}
+
+static void * mpmc_producer(void *arg) {
+    for (int i = 0; i < per_thread; i++) {
+        while (!cxq_mpmc_enqueue(&mq, &i))
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void * mpmc_consumer(void *arg) {
+    int data;
+    for (int i = 0; i < per_thread; i++) {
+        while (!cxq_mpmc_dequeue(&mq, &data))
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void * mutex_producer(void *arg) {
+    for (int i = 0; i < per_thread; i++) {
+        for (;;) {
+            lq_lock_acquire();
+            void *slot = cxq_enqueue(&lq, &i);
+            lq_lock_release();
+            if (slot) break;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void * mutex_consumer(void *arg) {
+    int data;
+    for (int i = 0; i < per_thread; i++) {
+        for (;;) {
+            lq_lock_acquire();
+            void *slot = cxq_dequeue(&lq, &data, true);
+            lq_lock_release();
+            if (slot) break;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/* Run n producers and n consumers, return ops/sec. */
+static double run(int n, void *(*prod)(void *), void *(*cons)(void *)) {
+    pthread_t tid[2 * n];
+    per_thread = ITEMS / n;
+    double t0 = now_sec();
+    for (int i = 0; i < n; i++) {
+        pthread_create(&tid[i], NULL, cons, NULL);
+        pthread_create(&tid[n + i], NULL, prod, NULL);
+    }
+    for (int i = 0; i < 2 * n; i++)
+        pthread_join(tid[i], NULL);
+    return (double)per_thread * n / (now_sec() - t0);
+}
+
+int main(int argc, char *argv[])
+{
+    int max_threads = (argc > 1) ? atoi(argv[1]) : 4;
+
+    cxq_mpmc_init(&mq, SLOTS, sizeof(int), NULL);
+    cxq_init(&lq, SLOTS, sizeof(int), NULL);
+
+    printf("threads,mpmc_ops_per_sec,mutex_ops_per_sec,speedup\n");
+    for (int n = 1; n <= max_threads; n++) {
+        double mpmc = run(n, mpmc_producer, mpmc_consumer);
+        double mutex = run(n, mutex_producer, mutex_consumer);
+        printf("%d,%.0f,%.0f,%.2f\n", n, mpmc, mutex, mpmc / mutex);
+    }
+
+    cxq_mpmc_finish(&mq);
+    cxq_finish(&lq);
+}
+
+#endif /*CXQ_MPMC_BENCH*/
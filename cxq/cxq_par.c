@@ -0,0 +1,129 @@
+/******************************************************************************
+
+ cxq_par.c - parallel traversal of a cxq_t
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "cxq_par.h"
+
+/* One thread's share of the traversal. */
+typedef struct {
+    cxq_span_t span[2];     /* Up to two ranges, split at the wrap. */
+    int spans;              /* Number of ranges. */
+    int stride;             /* Slot stride in bytes. */
+    cxq_span_fn_t fn;       /* Span callback. */
+    void *partial;          /* This thread's partial result. */
+} par_job_t;
+
+
+static void * _par_run(void *arg) {
+    par_job_t *job = arg;
+    for (int i = 0; i < job->spans; i++)
+        job->fn(job->span[i].data, job->span[i].n, job->stride, job->partial);
+    return NULL;
+}
+
+
+/* Cut elements [lo, hi) of the snapshot out of its spans. */
+static int _par_cut(const cxq_span_t *span, int spans, int stride,
+                    int lo, int hi, cxq_span_t *out) {
+    int n = 0;
+    for (int i = 0; i < spans && lo < hi; i++) {
+        if (lo < span[i].n) {
+            int end = (hi < span[i].n) ? hi : span[i].n;
+            out[n].data = span[i].data + lo * stride;
+            out[n].n = end - lo;
+            n++;
+        }
+        lo = (lo > span[i].n) ? lo - span[i].n : 0;
+        hi -= span[i].n;
+    }
+    return n;
+}
+
+
+/*
+  Description
+    Traverse the queue on `threads` threads.  The elements are split
+    into equal, contiguous shares, oldest first; each thread calls `fn`
+    on its share, at most twice, with its own partial result as `arg`.
+    The partial results are then folded into `result` in order.
+
+  Parameters
+    q          - Pointer to cxq_t struct.
+    threads    - Number of threads, the calling thread included.
+    fn         - Span callback, as for cxq_traverse_spans.  It's given a
+                 pointer to the thread's partial result.
+    reduce     - Folds a partial result into `result`, or NULL if `fn`
+                 does all the work itself.
+    result     - On entry, the identity value, e.g. 0 for a sum; each
+                 partial result starts as a copy of it.  On return, the
+                 folded result.
+    result_size - Size of `result` in bytes.
+
+  Returns
+    Number of elements traversed, or -1 if memory or a thread couldn't
+    be had.
+
+  Note
+    As with cxq_get_spans, the elements are read without the lock, so
+    nothing may dequeue or overwrite them until the call returns.
+*/
+int cxq_traverse_parallel(const cxq_t *q, int threads, cxq_span_fn_t fn,
+                          cxq_reduce_fn_t reduce, void *result,
+                          size_t result_size) {
+    cxq_span_t span[2];
+    int spans = cxq_get_spans(q, span);
+    int total = 0;
+    for (int i = 0; i < spans; i++)
+        total += span[i].n;
+    if (threads < 1)
+        threads = 1;
+    if (threads > total)
+        threads = total ? total : 1;
+
+    par_job_t *jobs = malloc(threads * sizeof(par_job_t));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    char *partials = malloc(threads * result_size);
+    if (!jobs || !tids || (!partials && result_size)) {
+        free(jobs);
+        free(tids);
+        free(partials);
+        return -1;
+    }
+
+    int rc = total, started = 0;
+    for (int t = 0; t < threads; t++) {
+        par_job_t *job = &jobs[t];
+        int lo = (int)((long long)total * t / threads);
+        int hi = (int)((long long)total * (t + 1) / threads);
+        job->spans = _par_cut(span, spans, q->stride, lo, hi, job->span);
+        job->stride = q->stride;
+        job->fn = fn;
+        job->partial = partials + t * result_size;
+        memcpy(job->partial, result, result_size);
+    }
+    /* Share 0 runs on the calling thread. */
+    for (int t = 1; t < threads; t++, started++) {
+        if (pthread_create(&tids[t], NULL, _par_run, &jobs[t])) {
+            rc = -1;
+            break;
+        }
+    }
+    _par_run(&jobs[0]);
+    for (int t = 1; t <= started; t++)
+        pthread_join(tids[t], NULL);
+    if (rc >= 0 && reduce) {
+        for (int t = 0; t < threads; t++)
+            reduce(result, jobs[t].partial);
+    }
+
+    free(jobs);
+    free(tids);
+    free(partials);
+    return rc;
+}
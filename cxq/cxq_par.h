@@ -0,0 +1,29 @@
+/******************************************************************************
+
+ cxq_par.h - parallel traversal of a cxq_t
+
+ Splits the elements in a queue across several threads, each calling a
+ span callback on its share, then folds the threads' partial results
+ together.  The queue lock is only taken to snapshot the indices, see
+ cxq_get_spans.
+
+ POSIX only, built on pthreads.  Build with -pthread.
+
+*******************************************************************************/
+
+#ifndef CXQ_PAR_H
+#define CXQ_PAR_H
+
+#include <stddef.h>
+
+#include "cxq.h"
+
+/* Fold a thread's partial result into the total. */
+typedef void (*cxq_reduce_fn_t)(void *result, const void *partial);
+
+int cxq_traverse_parallel(const cxq_t *q, int threads, cxq_span_fn_t fn,
+                          cxq_reduce_fn_t reduce, void *result,
+                          size_t result_size);
+
+
+#endif /* CXQ_PAR_H */
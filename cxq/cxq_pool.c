@@ -0,0 +1,237 @@
+/******************************************************************************
+
+ cxq_pool.c - fixed-size task executor on work-stealing deques
+
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L /* nanosleep */
+
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+
+#include "cxq_pool.h"
+
+/* Slots the injection queue starts with and may grow to. */
+#define INJECT_SLOTS        256
+#define INJECT_MAX_SLOTS    (1 << 20)
+
+/* Idle rounds a worker spins, then yields, before it sleeps. */
+#define IDLE_SPINS          64
+#define IDLE_YIELDS         64
+#define IDLE_SLEEP_NS       50000
+
+/* Worker running on this thread, or NULL. */
+static _Thread_local cxq_pool_worker_t *_current;
+
+/* Victim picker state for threads outside any pool. */
+static _Thread_local unsigned _seed = 1;
+
+
+/* xorshift32, for picking steal victims. */
+static inline unsigned _pool_rand(unsigned *s) {
+    unsigned x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+
+/* Take a task from the injection queue. */
+static bool _pool_take_injected(cxq_pool_t *p, cxq_task_t *task) {
+    bool ok;
+    if (atomic_load_explicit(&p->injected, memory_order_relaxed) <= 0)
+        return false;
+    pthread_mutex_lock(&p->inject_lock);
+    ok = cxq_dequeue(&p->inject, task, true) != NULL;
+    if (ok)
+        atomic_fetch_sub_explicit(&p->injected, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&p->inject_lock);
+    return ok;
+}
+
+
+/* Find a task: own deque first, then the injection queue, then steal,
+   starting from a random victim.  `self` is NULL outside the pool. */
+static bool _pool_find(cxq_pool_t *p, cxq_pool_worker_t *self,
+                       cxq_task_t *task) {
+    if (self && cxq_ws_pop(&self->deque, task))
+        return true;
+    if (_pool_take_injected(p, task))
+        return true;
+    int n = p->num_workers;
+    if (n <= 0)
+        return false;
+    int start = _pool_rand(self ? &self->seed : &_seed) % n;
+    for (int i = 0; i < n; i++) {
+        cxq_pool_worker_t *victim = &p->workers[(start + i) % n];
+        if (victim == self)
+            continue;
+        int r;
+        while ((r = cxq_ws_steal(&victim->deque, task)) == CXQ_WS_ABORT)
+            ;
+        if (r == CXQ_WS_OK)
+            return true;
+    }
+    return false;
+}
+
+
+/* Worker thread.  Runs tasks until the pool stops, backing off from
+   spinning to yielding to short sleeps while there's nothing to do. */
+static void * _pool_worker(void *arg) {
+    cxq_pool_worker_t *self = arg;
+    cxq_pool_t *p = self->pool;
+    cxq_task_t task;
+    int idle = 0;
+    _current = self;
+    while (!atomic_load_explicit(&p->stop, memory_order_relaxed)) {
+        if (_pool_find(p, self, &task)) {
+            task.fn(task.arg);
+            idle = 0;
+        } else if (++idle < IDLE_SPINS) {
+            /* Spin. */
+        } else if (idle < IDLE_SPINS + IDLE_YIELDS) {
+            sched_yield();
+        } else {
+            struct timespec ts = {0, IDLE_SLEEP_NS};
+            nanosleep(&ts, NULL);
+        }
+    }
+    _current = NULL;
+    return NULL;
+}
+
+
+/*
+  Description
+    Init the pool and start its worker threads.
+
+  Parameters
+    p          - Pointer to cxq_pool_t struct.
+    num_workers - Number of worker threads.  It may be 0, leaving all
+                 the work to threads in cxq_pool_wait.
+    deque_slots - Slots in each worker's deque.  A worker that spawns
+                 a task with its deque full runs it at once instead.
+
+  Returns
+    0, or -1 if the workers couldn't be allocated or a thread couldn't
+    be started.  The pool is unusable then and must still be finished.
+*/
+int cxq_pool_init(cxq_pool_t *p, int num_workers, int deque_slots) {
+    int rc = 0;
+    cxq_init(&p->inject, INJECT_SLOTS, sizeof(cxq_task_t), NULL);
+    cxq_set_growth(&p->inject, INJECT_MAX_SLOTS);
+    pthread_mutex_init(&p->inject_lock, NULL);
+    atomic_init(&p->injected, 0);
+    atomic_init(&p->stop, false);
+    p->num_workers = 0;
+    p->workers = calloc(num_workers, sizeof(cxq_pool_worker_t));
+    if (!p->workers && num_workers > 0)
+        return -1;
+    p->num_workers = num_workers;
+    for (int i = 0; i < num_workers; i++) {
+        cxq_pool_worker_t *w = &p->workers[i];
+        cxq_ws_init(&w->deque, deque_slots, sizeof(cxq_task_t));
+        w->pool = p;
+        w->seed = 2 * i + 1;
+    }
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&p->workers[i].tid, NULL, _pool_worker,
+                           &p->workers[i])) {
+            /* Finish only sees the workers that started. */
+            for (int j = i; j < num_workers; j++)
+                cxq_ws_finish(&p->workers[j].deque);
+            p->num_workers = i;
+            rc = -1;
+            break;
+        }
+    }
+    return rc;
+}
+
+
+/*
+  Description
+    Stop the workers, wait for them to exit, and free the pool.  Tasks
+    still queued are dropped.
+
+  Parameters
+    p          - Pointer to cxq_pool_t struct.
+
+  Returns
+    None
+*/
+void cxq_pool_finish(cxq_pool_t *p) {
+    atomic_store(&p->stop, true);
+    for (int i = 0; i < p->num_workers; i++)
+        pthread_join(p->workers[i].tid, NULL);
+    for (int i = 0; i < p->num_workers; i++)
+        cxq_ws_finish(&p->workers[i].deque);
+    free(p->workers);
+    pthread_mutex_destroy(&p->inject_lock);
+    cxq_finish(&p->inject);
+}
+
+
+/*
+  Description
+    Spawn a task.  From a worker of this pool it goes on that worker's
+    deque, otherwise on the injection queue.
+
+  Parameters
+    p          - Pointer to cxq_pool_t struct.
+    fn         - Task function.
+    arg        - Its argument.
+
+  Returns
+    None
+
+  Note
+    If the task can't be queued, because the deque or the injection
+    queue is full, it runs at once on the calling thread.
+*/
+void cxq_pool_submit(cxq_pool_t *p, cxq_task_fn_t fn, void *arg) {
+    cxq_task_t task = {fn, arg};
+    if (_current && _current->pool == p) {
+        if (cxq_ws_push(&_current->deque, &task))
+            return;
+    } else {
+        pthread_mutex_lock(&p->inject_lock);
+        bool ok = cxq_enqueue(&p->inject, &task) != NULL;
+        if (ok)
+            atomic_fetch_add_explicit(&p->injected, 1, memory_order_relaxed);
+        pthread_mutex_unlock(&p->inject_lock);
+        if (ok)
+            return;
+    }
+    fn(arg);
+}
+
+
+/*
+  Description
+    Join: run pool tasks on the calling thread until `*pending` drops to
+    zero.  Tasks are expected to decrement it as they finish.  Works
+    from inside a task too, so a task can fork children and wait for
+    them without tying up its worker.
+
+  Parameters
+    p          - Pointer to cxq_pool_t struct.
+    pending    - Counter of outstanding tasks.
+
+  Returns
+    None
+*/
+void cxq_pool_wait(cxq_pool_t *p, atomic_int *pending) {
+    cxq_pool_worker_t *self = (_current && _current->pool == p) ? _current
+                                                                 : NULL;
+    cxq_task_t task;
+    while (atomic_load_explicit(pending, memory_order_acquire) > 0) {
+        if (_pool_find(p, self, &task))
+            task.fn(task.arg);
+        else
+            sched_yield();
+    }
+}
@@ -0,0 +1,59 @@
+/******************************************************************************
+
+ cxq_pool.h - fixed-size task executor on work-stealing deques
+
+ A pool of worker threads, each owning a cxq_ws_t deque of tasks.  A
+ task spawned by a worker goes on its own deque and the worker runs
+ its newest task first; an idle worker steals the oldest task of a
+ random victim.  Tasks from outside the pool go through one locked
+ cxq_t injection queue.  Joining is done by counting: cxq_pool_wait
+ runs tasks until a counter the tasks decrement drops to zero, so a
+ waiting thread helps rather than blocks.
+
+ POSIX only, built on pthreads.  Build with -pthread.
+
+*******************************************************************************/
+
+#ifndef CXQ_POOL_H
+#define CXQ_POOL_H
+
+#include <pthread.h>
+
+#include "cxq.h"
+#include "cxq_ws.h"
+
+typedef void (*cxq_task_fn_t)(void *arg);
+
+typedef struct {
+    cxq_task_fn_t fn;       /* Task function. */
+    void *arg;              /* Its argument. */
+} cxq_task_t;
+
+typedef struct cxq_pool cxq_pool_t;
+
+typedef struct {
+    cxq_ws_t deque;         /* Tasks spawned by this worker. */
+    pthread_t tid;          /* Worker thread. */
+    cxq_pool_t *pool;       /* Owning pool. */
+    unsigned seed;          /* Victim picker state. */
+} cxq_pool_worker_t;
+
+struct cxq_pool {
+    cxq_pool_worker_t *workers; /* One per thread. */
+    int num_workers;        /* Number of worker threads. */
+    cxq_t inject;           /* Tasks submitted from outside the pool. */
+    pthread_mutex_t inject_lock;    /* Guards `inject`. */
+    atomic_int injected;    /* Count of `inject`, read without the lock. */
+    atomic_bool stop;       /* Set by cxq_pool_finish. */
+};
+
+/* construction/destruction */
+int  cxq_pool_init(cxq_pool_t *p, int num_workers, int deque_slots);
+void cxq_pool_finish(cxq_pool_t *p);
+
+/* spawn and join */
+void cxq_pool_submit(cxq_pool_t *p, cxq_task_fn_t fn, void *arg);
+void cxq_pool_wait(cxq_pool_t *p, atomic_int *pending);
+
+
+#endif /* CXQ_POOL_H */
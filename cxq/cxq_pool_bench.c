@@ -0,0 +1,135 @@
+#include "cxq.h"
+#include "cxq_pool.h"
+
+//#define CXQ_POOL_BENCH
+
+#ifdef CXQ_POOL_BENCH
+
+/* Fork/join benchmark of cxq_pool_t against one shared cxq_t guarded by
+   a mutex.  Each run executes a binary task tree of the given depth:
+   every inner task spawns two children, every leaf spins for LEAF_WORK
+   iterations, and the run ends when the count of unfinished tasks
+   drops to zero.  For the shared queue, N threads take tasks from the
+   one queue and spawn into it; in the pool, tasks spawn onto their
+   worker's deque and idle workers steal.  The main thread runs tasks
+   too while it waits in cxq_pool_wait, so N pool threads are N - 1
+   workers plus the main thread.  Prints CSV for 1..N threads.
+   Build with -pthread.  Usage: ./a.out [max_threads] [depth]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define LEAF_WORK   200
+
+static cxq_pool_t pool;
+static cxq_t shared;
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int pending;
+static volatile unsigned sink;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void leaf(void) {
+    unsigned x = 1;
+    for (int i = 0; i < LEAF_WORK; i++)
+        x = x * 1103515245 + 12345;
+    sink = x;
+}
+
+/* Pool task: the argument is the depth left. */
+static void pool_task(void *arg) {
+    int depth = (int)(intptr_t)arg;
+    if (depth > 0) {
+        atomic_fetch_add(&pending, 2);
+        cxq_pool_submit(&pool, pool_task, (void *)(intptr_t)(depth - 1));
+        cxq_pool_submit(&pool, pool_task, (void *)(intptr_t)(depth - 1));
+    } else {
+        leaf();
+    }
+    atomic_fetch_sub(&pending, 1);
+}
+
+/* Shared queue: spawn by enqueueing the depth left. */
+static void shared_spawn(int depth) {
+    pthread_mutex_lock(&shared_lock);
+    cxq_enqueue(&shared, &depth);
+    pthread_mutex_unlock(&shared_lock);
+}
+
+static void * shared_worker(void *arg) {
+    int depth;
+    (void)arg;
+    while (atomic_load(&pending) > 0) {
+        pthread_mutex_lock(&shared_lock);
+        void *slot = cxq_dequeue(&shared, &depth, true);
+        pthread_mutex_unlock(&shared_lock);
+        if (!slot) {
+            sched_yield();
+            continue;
+        }
+        if (depth > 0) {
+            atomic_fetch_add(&pending, 2);
+            shared_spawn(depth - 1);
+            shared_spawn(depth - 1);
+        } else {
+            leaf();
+        }
+        atomic_fetch_sub(&pending, 1);
+    }
+    return NULL;
+}
+
+static double run_pool(int threads, int depth) {
+    /* The main thread is the last of `threads`. */
+    cxq_pool_init(&pool, threads - 1, 256);
+    double t0 = now_sec();
+    atomic_store(&pending, 1);
+    cxq_pool_submit(&pool, pool_task, (void *)(intptr_t)depth);
+    cxq_pool_wait(&pool, &pending);
+    double t1 = now_sec();
+    cxq_pool_finish(&pool);
+    return t1 - t0;
+}
+
+static double run_shared(int threads, int depth) {
+    pthread_t tid[threads];
+    /* Breadth first, so the queue must hold a whole level of leaves. */
+    cxq_init(&shared, 1024, sizeof(int), NULL);
+    cxq_set_growth(&shared, 2 << depth);
+    double t0 = now_sec();
+    atomic_store(&pending, 1);
+    shared_spawn(depth);
+    for (int i = 0; i < threads; i++)
+        pthread_create(&tid[i], NULL, shared_worker, NULL);
+    for (int i = 0; i < threads; i++)
+        pthread_join(tid[i], NULL);
+    double t1 = now_sec();
+    cxq_finish(&shared);
+    return t1 - t0;
+}
+
+int main(int argc, char *argv[])
+{
+    int max_threads = (argc > 1) ? atoi(argv[1]) : 4;
+    int depth = (argc > 2) ? atoi(argv[2]) : 18;
+    long tasks = (2L << depth) - 1;
+
+    printf("mode,threads,depth,tasks,seconds,tasks_per_sec\n");
+    for (int n = 1; n <= max_threads; n++) {
+        double t = run_shared(n, depth);
+        printf("shared,%d,%d,%ld,%.4f,%.0f\n", n, depth, tasks, t, tasks / t);
+        t = run_pool(n, depth);
+        printf("pool,%d,%d,%ld,%.4f,%.0f\n", n, depth, tasks, t, tasks / t);
+        fflush(stdout);
+    }
+}
+
+#endif /*CXQ_POOL_BENCH*/
@@ -0,0 +1,159 @@
+/******************************************************************************
+
+ cxq_prio.c - multi-level priority queue
+
+*******************************************************************************/
+
+#include <stdlib.h>
+
+#include "cxq_prio.h"
+#include "../c/bit.h"
+
+/* bit.h's BIT() is an unsigned long, only 32 bits on some targets. */
+#define BIT64(x)                ((uint64_t)1 << (x))
+
+/* Index of the lowest set bit of a non-zero 64-bit word. */
+#ifdef __GNUC__
+#define bit_ffs64(x)            __builtin_ctzll(x)
+#else
+static inline int bit_ffs64(uint64_t x) {
+    /* De Bruijn multiply, for compilers without a builtin. */
+    static const int pos[64] = {
+         0,  1,  2, 53,  3,  7, 54, 27,  4, 38, 41,  8, 34, 55, 48, 28,
+        62,  5, 39, 46, 44, 42, 22,  9, 24, 35, 59, 56, 49, 18, 29, 11,
+        63, 52,  6, 26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10,
+        51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12,
+    };
+    return pos[((x & -x) * 0x022FDD63CC95386DULL) >> 58];
+}
+#endif
+
+
+/*
+  Description
+    Init the queue.
+
+  Parameters
+    q          - Pointer to cxq_prio_t struct.
+    levels     - Number of priority levels, 1..CXQ_PRIO_LEVELS.
+    slots      - Number of queue positions in each level.
+    data_size  - The size of each queue element.
+    handlers   - Pointer to memfuns_t stuct that manages memory allocation
+                 for queue elements, same as for cxq_init.  malloc_fn is
+                 called once per level.
+
+  Returns
+    0, or -1 if `levels` is out of range or the bands couldn't be
+    allocated.  The queue then has no levels, so every enqueue fails,
+    and must still be finished.
+*/
+int cxq_prio_init(cxq_prio_t *q, int levels, int slots, int data_size,
+                  memfuns_t *handlers) {
+    q->levels = 0;
+    q->count = 0;
+    q->ready = 0;
+    q->bands = NULL;
+    MUTEX_INIT(q->lock, NULL);
+    if (levels < 1 || levels > CXQ_PRIO_LEVELS)
+        return -1;
+    q->bands = malloc(levels * sizeof(cxq_t));
+    if (!q->bands)
+        return -1;
+    q->levels = levels;
+    for (int i = 0; i < levels; i++)
+        cxq_init(&q->bands[i], slots, data_size, handlers);
+    return 0;
+}
+
+
+/*
+  Description
+    De-init queue, free memory.
+
+  Parameters
+    q          - Pointer to cxq_prio_t struct.
+
+  Returns
+    None
+*/
+void cxq_prio_finish(cxq_prio_t *q) {
+    MUTEX_DESTROY(q->lock);
+    for (int i = 0; i < q->levels; i++)
+        cxq_finish(&q->bands[i]);
+    free(q->bands);
+}
+
+
+/*
+  Description
+    Add an element to the end of its priority level.
+
+  Parameters
+    q          - Pointer to cxq_prio_t struct.
+    data       - Pointer to source memory for enqueued element.
+    prio       - Priority level, 0 (most urgent) to levels - 1.
+
+  Returns
+    slot - A pointer to the enqueued data element, or NULL if that
+    level is full or `prio` is out of range.
+*/
+void * cxq_prio_enqueue(cxq_prio_t *q, const void *data, int prio) {
+    void * slot = NULL;
+    if (prio < 0 || prio >= q->levels)
+        return NULL;
+    LOCK(q->lock);
+    slot = cxq_enqueue(&q->bands[prio], data);
+    if (slot) {
+        bit_set(q->ready, BIT64(prio));
+        q->count++;
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/*
+  Description
+    Remove the oldest element of the most urgent non-empty level.
+
+  Parameters
+    q          - Pointer to cxq_prio_t struct.
+    data       - Pointer to destination memory for dequeued element.
+    prio       - Set to the element's priority level, if not NULL.
+
+  Returns
+    slot - A pointer to the dequeued data element, or NULL if the queue
+    is empty.  As with cxq_dequeue, it's valid until overwritten.
+*/
+void * cxq_prio_dequeue(cxq_prio_t *q, void *data, int *prio) {
+    void * slot = NULL;
+    LOCK(q->lock);
+    if (q->ready) {
+        int level = bit_ffs64(q->ready);
+        cxq_t *band = &q->bands[level];
+        slot = cxq_dequeue(band, data, true);
+        if (cxq_isempty(band))
+            bit_clear(q->ready, BIT64(level));
+        q->count--;
+        if (prio)
+            *prio = level;
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/* Returns num of elements in all levels. */
+int cxq_prio_get_count(const cxq_prio_t *q) {return q->count;}
+
+
+/* Returns num of elements in level `prio`. */
+int cxq_prio_get_level_count(const cxq_prio_t *q, int prio) {
+    if (prio < 0 || prio >= q->levels)
+        return 0;
+    return cxq_get_count(&q->bands[prio]);
+}
+
+
+/* Returns true if all levels are empty. */
+bool cxq_prio_isempty(const cxq_prio_t *q) {return q->ready == 0;}
@@ -0,0 +1,46 @@
+/******************************************************************************
+
+ cxq_prio.h - multi-level priority queue
+
+ One cxq_t band per priority level, 0 being the most urgent, plus a
+ bitmap with a bit set for each non-empty band.  Dequeue takes from the
+ lowest set bit, found with a single find-first-set, so enqueue and
+ dequeue are O(1) whatever the number of levels.  Elements of the same
+ priority come out in FIFO order.
+
+*******************************************************************************/
+
+#ifndef CXQ_PRIO_H
+#define CXQ_PRIO_H
+
+#include "cxq.h"
+
+/* Max number of levels, one bit each in `ready`. */
+#define CXQ_PRIO_LEVELS 64
+
+typedef struct {
+    cxq_t *bands;           /* One queue per level, 0 = most urgent. */
+    int levels;             /* Number of bands. */
+    int count;              /* Elements in all bands. */
+    uint64_t ready;         /* Bit n set while band n is not empty. */
+#ifdef MULTI_THREAD
+    cxq_mutex_t lock;       /* Keeps `ready` in step with the bands. */
+#endif
+} cxq_prio_t;
+
+/* construction/destruction */
+int  cxq_prio_init(cxq_prio_t *q, int levels, int slots, int data_size,
+                   memfuns_t *handlers);
+void cxq_prio_finish(cxq_prio_t *q);
+
+/* enqueue/dequeue */
+void * cxq_prio_enqueue(cxq_prio_t *q, const void *data, int prio);
+void * cxq_prio_dequeue(cxq_prio_t *q, void *data, int *prio);
+
+/* count/isempty */
+int  cxq_prio_get_count(const cxq_prio_t *q);
+int  cxq_prio_get_level_count(const cxq_prio_t *q, int prio);
+bool cxq_prio_isempty(const cxq_prio_t *q);
+
+
+#endif /* CXQ_PRIO_H */
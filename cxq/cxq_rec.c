@@ -0,0 +1,241 @@
+/******************************************************************************
+
+ cxq_rec.c - variable-length record queue
+
+ Each record is a CXQ_REC_ALIGN byte header holding the payload length,
+ followed by the payload, rounded up to CXQ_REC_ALIGN.  A header with
+ length REC_PAD marks the unused tail of the ring after a wrap.
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cxq_rec.h"
+
+#define REC_PAD     0xFFFFFFFFU
+
+/* Round n up to a multiple of CXQ_REC_ALIGN. */
+#define REC_ROUND(n)    (((n) + CXQ_REC_ALIGN - 1) & ~(CXQ_REC_ALIGN - 1))
+
+/* Header at offset `off` in the ring. */
+#define REC_HDR(q, off) ((uint32_t *)((q)->data + (off)))
+
+
+/* Returns bytes a record of `len` payload bytes takes in the ring. */
+int cxq_rec_record_size(int len) {return CXQ_REC_ALIGN + REC_ROUND(len);}
+
+
+/*
+  Description
+    Init the queue.
+
+  Parameters
+    q          - Pointer to cxq_rec_t struct.
+    size       - Ring size in bytes, rounded down to CXQ_REC_ALIGN.
+                 The largest record payload is size - CXQ_REC_ALIGN.
+    handlers   - Pointer to memfuns_t stuct that manages memory allocation
+                 for the ring, as for cxq_init.  memcpy_fn is called once
+                 per record with the payload length.
+
+  Returns
+    None
+*/
+void cxq_rec_init(cxq_rec_t *q, int size, memfuns_t *handlers) {
+    q->size = size & ~(CXQ_REC_ALIGN - 1);
+    q->first = 0;
+    q->used = 0;
+    q->count = 0;
+    q->held = false;
+    q->handlers = malloc(sizeof(memfuns_t));
+    if (handlers) {
+        q->handlers->malloc_fn = handlers->malloc_fn;
+        q->handlers->free_fn = handlers->free_fn;
+        q->handlers->memcpy_fn = handlers->memcpy_fn;
+        q->handlers->move_fn = handlers->move_fn;
+        q->handlers->swap_fn = handlers->swap_fn;
+    } else {
+        /* Default handlers. */
+        q->handlers->malloc_fn = malloc;
+        q->handlers->free_fn = free;
+        q->handlers->memcpy_fn = memcpy;
+        q->handlers->move_fn = NULL;
+        q->handlers->swap_fn = NULL;
+    }
+    if (q->handlers->malloc_fn)
+        q->data = q->handlers->malloc_fn(q->size);
+    MUTEX_INIT(q->lock, NULL);
+}
+
+
+/*
+  Description
+    De-init queue, free memory.
+
+  Parameters
+    q          - Pointer to cxq_rec_t struct.
+
+  Returns
+    None
+*/
+void cxq_rec_finish(cxq_rec_t *q) {
+    MUTEX_DESTROY(q->lock);
+    if (q->handlers->free_fn)
+        q->handlers->free_fn(q->data);
+    free(q->handlers);
+}
+
+
+/* Skip the padding marker at `first`, if any.  Lock must be held. */
+static void _rec_skip_pad(cxq_rec_t *q) {
+    if (q->used > 0 && *REC_HDR(q, q->first) == REC_PAD) {
+        q->used -= q->size - q->first;
+        q->first = 0;
+    }
+}
+
+
+/* Drop the first record.  Lock must be held. */
+static void _rec_remove(cxq_rec_t *q) {
+    int rsize = cxq_rec_record_size(*REC_HDR(q, q->first));
+    q->first += rsize;
+    q->used -= rsize;
+    q->count--;
+    if (q->first == q->size || q->used == 0)
+        q->first = 0;
+    _rec_skip_pad(q);
+}
+
+
+/*
+  Description
+    Add a record to end of queue.
+
+  Parameters
+    q          - Pointer to cxq_rec_t struct.
+    data       - Pointer to the payload.
+    len        - Payload length in bytes.
+
+  Returns
+    A pointer to the stored payload, or NULL if `len` is negative, more
+    than the ring can ever hold, or there's no contiguous room for it.
+*/
+void * cxq_rec_enqueue(cxq_rec_t *q, const void *data, int len) {
+    int need, tail;
+    void * slot = NULL;
+    /* A length of -1 would read back as REC_PAD, and one near INT_MAX
+       would overflow when rounded up. */
+    if (len < 0 || len > q->size - CXQ_REC_ALIGN)
+        return NULL;
+    need = cxq_rec_record_size(len);
+    LOCK(q->lock);
+    if (q->used == 0)
+        q->first = 0;
+    tail = q->first + q->used;
+    if (tail < q->size) {
+        /* Free space is [tail, size) and [0, first). */
+        if (need > q->size - tail && need <= q->first) {
+            /* Pad out the end of the ring, start over at 0. */
+            *REC_HDR(q, tail) = REC_PAD;
+            q->used += q->size - tail;
+            tail = 0;
+        } else if (need > q->size - tail) {
+            need = 0;
+        }
+    } else {
+        /* Wrapped, free space is [tail - size, first). */
+        tail -= q->size;
+        if (need > q->first - tail)
+            need = 0;
+    }
+    if (need > 0) {
+        *REC_HDR(q, tail) = len;
+        slot = q->data + tail + CXQ_REC_ALIGN;
+        if (q->handlers->memcpy_fn)
+            q->handlers->memcpy_fn(slot, data, len);
+        q->used += need;
+        q->count++;
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/*
+  Description
+    Remove the first record and copy its payload to `data`.
+
+  Parameters
+    q          - Pointer to cxq_rec_t struct.
+    data       - Pointer to destination memory.
+    maxlen     - Size of `data` in bytes.
+
+  Returns
+    Payload length, or -1 if the queue is empty or the first record is
+    held by cxq_rec_peek.  If the length is more than `maxlen`, nothing
+    is copied and the record stays in the queue.
+*/
+int cxq_rec_dequeue(cxq_rec_t *q, void *data, int maxlen) {
+    int len = -1;
+    LOCK(q->lock);
+    if (q->count > 0 && !q->held) {
+        len = *REC_HDR(q, q->first);
+        if (len <= maxlen) {
+            if (q->handlers->memcpy_fn)
+                q->handlers->memcpy_fn(data,
+                                       q->data + q->first + CXQ_REC_ALIGN, len);
+            _rec_remove(q);
+        }
+    }
+    UNLOCK(q->lock);
+    return len;
+}
+
+
+/*
+  Description
+    Get a pointer to the first record's payload without copying it.  It
+    stays valid until cxq_rec_release.
+
+  Parameters
+    q          - Pointer to cxq_rec_t struct.
+    len        - Set to the payload length.
+
+  Returns
+    A pointer to the payload, or NULL if the queue is empty or a record
+    is already held.
+*/
+void * cxq_rec_peek(cxq_rec_t *q, int *len) {
+    void * slot = NULL;
+    LOCK(q->lock);
+    if (q->count > 0 && !q->held) {
+        *len = *REC_HDR(q, q->first);
+        slot = q->data + q->first + CXQ_REC_ALIGN;
+        q->held = true;
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/* Remove the record returned by cxq_rec_peek. */
+void cxq_rec_release(cxq_rec_t *q) {
+    LOCK(q->lock);
+    if (q->held) {
+        q->held = false;
+        _rec_remove(q);
+    }
+    UNLOCK(q->lock);
+}
+
+
+/* Returns num of records in queue. */
+int cxq_rec_get_count(const cxq_rec_t *q) {return q->count;}
+
+
+/* Returns true if queue is empty. */
+bool cxq_rec_isempty(const cxq_rec_t *q) {return q->count <= 0;}
+
+
+/* Returns bytes in use, headers and padding included. */
+int cxq_rec_bytes_used(const cxq_rec_t *q) {return q->used;}
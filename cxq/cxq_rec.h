@@ -0,0 +1,53 @@
+/******************************************************************************
+
+ cxq_rec.h - variable-length record queue
+
+ A byte ring holding length-prefixed records packed back to back.  A
+ record never wraps: if it doesn't fit before the end of the ring, the
+ rest of the ring is marked as padding and the record starts over at
+ offset 0, so every record, and every pointer from cxq_rec_peek, is one
+ contiguous run of bytes.
+
+*******************************************************************************/
+
+#ifndef CXQ_REC_H
+#define CXQ_REC_H
+
+#include "cxq.h"
+
+/* Record payloads are aligned to this many bytes. */
+#define CXQ_REC_ALIGN   8
+
+typedef struct {
+    void *data;             /* Pointer to body of ring. */
+    int size;               /* Ring size in bytes. */
+    int first;              /* Offset of first record. */
+    int used;               /* Bytes in use, headers and padding included. */
+    int count;              /* Number of records. */
+    bool held;              /* First record handed out by cxq_rec_peek. */
+    memfuns_t *handlers;    /* Memory callback functions. */
+#ifdef MULTI_THREAD
+    cxq_mutex_t lock;       /* Queue lock. */
+#endif
+} cxq_rec_t;
+
+/* construction/destruction */
+void cxq_rec_init(cxq_rec_t *q, int size, memfuns_t *handlers);
+void cxq_rec_finish(cxq_rec_t *q);
+
+/* enqueue/dequeue */
+void * cxq_rec_enqueue(cxq_rec_t *q, const void *data, int len);
+int    cxq_rec_dequeue(cxq_rec_t *q, void *data, int maxlen);
+
+/* zero-copy peek/release */
+void * cxq_rec_peek(cxq_rec_t *q, int *len);
+void   cxq_rec_release(cxq_rec_t *q);
+
+/* count/isempty/bytes */
+int  cxq_rec_get_count(const cxq_rec_t *q);
+bool cxq_rec_isempty(const cxq_rec_t *q);
+int  cxq_rec_bytes_used(const cxq_rec_t *q);
+int  cxq_rec_record_size(int len);
+
+
+#endif /* CXQ_REC_H */
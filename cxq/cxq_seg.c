@@ -0,0 +1,246 @@
+/******************************************************************************
+
+ cxq_seg.c - unbounded segmented queue
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cxq_seg.h"
+
+
+/* Free a segment and its body. */
+static void _seg_free(cxq_seg_t *q, cxq_seg_node_t *s) {
+    if (q->handlers->free_fn)
+        q->handlers->free_fn(s->data);
+    free(s);
+}
+
+
+/* Take a segment from the free list, or allocate one.  Lock must be
+   held.  Returns NULL if the allocation fails. */
+static cxq_seg_node_t * _seg_get(cxq_seg_t *q) {
+    cxq_seg_node_t *s = q->spare;
+    if (s) {
+        q->spare = s->next;
+        q->num_spare--;
+    } else {
+        s = malloc(sizeof(cxq_seg_node_t));
+        if (!s)
+            return NULL;
+        s->data = q->handlers->malloc_fn ?
+            q->handlers->malloc_fn((size_t)q->seg_slots * q->data_size) : NULL;
+        if (!s->data) {
+            free(s);
+            return NULL;
+        }
+    }
+    s->next = NULL;
+    s->first = 0;
+    s->last = 0;
+    return s;
+}
+
+
+/* Put a drained segment on the free list, or free it if the list is
+   full.  Lock must be held. */
+static void _seg_put(cxq_seg_t *q, cxq_seg_node_t *s) {
+    if (q->num_spare < q->max_spare) {
+        s->next = q->spare;
+        q->spare = s;
+        q->num_spare++;
+    } else {
+        _seg_free(q, s);
+    }
+}
+
+
+/* Recycle the head segment if the last dequeue drained it.  It's kept
+   linked until the next call so the pointer that dequeue returned stays
+   valid.  Lock must be held. */
+static void _seg_retire(cxq_seg_t *q) {
+    cxq_seg_node_t *s = q->head;
+    if (s && s != q->tail && s->first == s->last) {
+        q->head = s->next;
+        q->segments--;
+        _seg_put(q, s);
+    }
+}
+
+
+/*
+  Description
+    Init the queue with one empty segment.
+
+  Parameters
+    q          - Pointer to cxq_seg_t struct.
+    seg_slots  - Number of slots per segment.
+    data_size  - The size of each queue element.
+    handlers   - Pointer to memfuns_t stuct that manages memory allocation
+                 for queue elements, as for cxq_init.  malloc_fn is called
+                 once per segment body, so it must not hand out a single
+                 static array.
+    max_spare  - Max number of drained segments kept for reuse.  Enough
+                 to cover the usual backlog means no allocation in steady
+                 state; the rest are freed as bursts drain.
+
+  Returns
+    None
+*/
+void cxq_seg_init(cxq_seg_t *q, int seg_slots, int data_size,
+                  memfuns_t *handlers, int max_spare) {
+    q->seg_slots = seg_slots;
+    q->data_size = data_size;
+    q->count = 0;
+    q->spare = NULL;
+    q->num_spare = 0;
+    q->max_spare = max_spare;
+    q->handlers = malloc(sizeof(memfuns_t));
+    if (handlers) {
+        q->handlers->malloc_fn = handlers->malloc_fn;
+        q->handlers->free_fn = handlers->free_fn;
+        q->handlers->memcpy_fn = handlers->memcpy_fn;
+        q->handlers->move_fn = handlers->move_fn;
+        q->handlers->swap_fn = handlers->swap_fn;
+    } else {
+        /* Default handlers. */
+        q->handlers->malloc_fn = malloc;
+        q->handlers->free_fn = free;
+        q->handlers->memcpy_fn = memcpy;
+        q->handlers->move_fn = NULL;
+        q->handlers->swap_fn = NULL;
+    }
+    q->head = q->tail = _seg_get(q);
+    q->segments = q->head ? 1 : 0;
+    MUTEX_INIT(q->lock, NULL);
+}
+
+
+/*
+  Description
+    De-init queue, free memory.
+
+  Parameters
+    q          - Pointer to cxq_seg_t struct.
+
+  Returns
+    None
+*/
+void cxq_seg_finish(cxq_seg_t *q) {
+    cxq_seg_trim(q, 0);
+    MUTEX_DESTROY(q->lock);
+    while (q->head) {
+        cxq_seg_node_t *s = q->head;
+        q->head = s->next;
+        _seg_free(q, s);
+    }
+    free(q->handlers);
+}
+
+
+/*
+  Description
+    Add an element to end of queue, linking a new segment if the tail
+    one is full.
+
+  Parameters
+    q          - Pointer to cxq_seg_t struct.
+    data       - Pointer to source memory for enqueued element.
+
+  Returns
+    slot - A pointer to the enqueued data element, or NULL if a new
+    segment was needed and couldn't be allocated.  The element stays at
+    this address until it's dequeued.
+*/
+void * cxq_seg_enqueue(cxq_seg_t *q, const void *data) {
+    void * slot = NULL;
+    LOCK(q->lock);
+    _seg_retire(q);
+    cxq_seg_node_t *s = q->tail;
+    if (!s || s->last == q->seg_slots) {
+        s = _seg_get(q);
+        if (s) {
+            if (q->tail)
+                q->tail->next = s;
+            else
+                q->head = s;
+            q->tail = s;
+            q->segments++;
+        }
+    }
+    if (s) {
+        slot = s->data + s->last * q->data_size;
+        if (q->handlers->memcpy_fn)
+            q->handlers->memcpy_fn(slot, data, q->data_size);
+        s->last++;
+        q->count++;
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/*
+  Description
+    Remove the first element.  A drained segment is recycled on the next
+    enqueue or dequeue.
+
+  Parameters
+    q          - Pointer to cxq_seg_t struct.
+    data       - Pointer to destination memory for dequeued element, or
+                 NULL to only get a pointer to it.
+
+  Returns
+    slot - A pointer to the dequeued data element, or NULL if the queue
+    is empty.  It's valid until the next enqueue or dequeue.
+*/
+void * cxq_seg_dequeue(cxq_seg_t *q, void *data) {
+    void * slot = NULL;
+    LOCK(q->lock);
+    _seg_retire(q);
+    cxq_seg_node_t *s = q->head;
+    if (q->count > 0) {
+        slot = s->data + s->first * q->data_size;
+        if (data && q->handlers->memcpy_fn)
+            q->handlers->memcpy_fn(data, slot, q->data_size);
+        s->first++;
+        q->count--;
+        if (s->first == s->last && s == q->tail) {
+            /* Last segment, reuse it in place. */
+            s->first = 0;
+            s->last = 0;
+        }
+    }
+    UNLOCK(q->lock);
+    return slot;
+}
+
+
+/* Returns num of elements in queue. */
+int cxq_seg_get_count(const cxq_seg_t *q) {return q->count;}
+
+
+/* Returns true if queue is empty. */
+bool cxq_seg_isempty(const cxq_seg_t *q) {return q->count <= 0;}
+
+
+/* Returns num of segments linked in the queue. */
+int cxq_seg_get_segments(const cxq_seg_t *q) {return q->segments;}
+
+
+/* Returns num of drained segments kept for reuse. */
+int cxq_seg_get_spare(const cxq_seg_t *q) {return q->num_spare;}
+
+
+/* Free spare segments until at most `keep` are left. */
+void cxq_seg_trim(cxq_seg_t *q, int keep) {
+    LOCK(q->lock);
+    while (q->num_spare > keep) {
+        cxq_seg_node_t *s = q->spare;
+        q->spare = s->next;
+        q->num_spare--;
+        _seg_free(q, s);
+    }
+    UNLOCK(q->lock);
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+
+ cxq_seg.h - unbounded segmented queue
+
+ A linked list of fixed-size segments, each a small array of slots.
+ The producer fills the tail segment and links another when it's full;
+ the consumer drains the head segment and unlinks it once empty.
+ Elements are never moved after they're enqueued, so there is no bulk
+ copy when the queue grows.  Drained segments go on a free list and are
+ reused before anything is allocated, so a queue in steady state
+ doesn't allocate at all; segments beyond `max_spare` are freed, which
+ returns the memory once a burst has been drained.
+
+*******************************************************************************/
+
+#ifndef CXQ_SEG_H
+#define CXQ_SEG_H
+
+#include "cxq.h"
+
+typedef struct cxq_seg_node {
+    struct cxq_seg_node *next;  /* Next newer segment. */
+    void *data;             /* Body of seg_slots slots. */
+    int first;              /* Next slot to dequeue. */
+    int last;               /* Next slot to enqueue. */
+} cxq_seg_node_t;
+
+typedef struct {
+    cxq_seg_node_t *head;   /* Oldest segment, dequeued from. */
+    cxq_seg_node_t *tail;   /* Newest segment, enqueued to. */
+    cxq_seg_node_t *spare;  /* Free list of drained segments. */
+    int seg_slots;          /* Slots per segment. */
+    int data_size;          /* Size of each queue element. */
+    int count;              /* Elements in all segments. */
+    int segments;           /* Segments linked in the queue. */
+    int num_spare;          /* Segments on the free list. */
+    int max_spare;          /* Cap on the free list. */
+    memfuns_t *handlers;    /* Memory callback functions. */
+#ifdef MULTI_THREAD
+    cxq_mutex_t lock;       /* Queue lock. */
+#endif
+} cxq_seg_t;
+
+/* construction/destruction */
+void cxq_seg_init(cxq_seg_t *q, int seg_slots, int data_size,
+                  memfuns_t *handlers, int max_spare);
+void cxq_seg_finish(cxq_seg_t *q);
+
+/* enqueue/dequeue */
+void * cxq_seg_enqueue(cxq_seg_t *q, const void *data);
+void * cxq_seg_dequeue(cxq_seg_t *q, void *data);
+
+/* count/isempty/memory */
+int  cxq_seg_get_count(const cxq_seg_t *q);
+bool cxq_seg_isempty(const cxq_seg_t *q);
+int  cxq_seg_get_segments(const cxq_seg_t *q);
+int  cxq_seg_get_spare(const cxq_seg_t *q);
+void cxq_seg_trim(cxq_seg_t *q, int keep);
+
+
+#endif /* CXQ_SEG_H */
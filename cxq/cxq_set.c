@@ -0,0 +1,181 @@
+/******************************************************************************
+
+ cxq_set.c - wait on many queues at once
+
+*******************************************************************************/
+
+#include "cxq_set.h"
+
+#define BIT64(x)    ((uint64_t)1 << (x))
+
+/* Max count for the wakeup semaphore. */
+#define CXQ_SET_SEM_MAX 0xFFFF
+
+
+/* Flag queue `index` as ready, and wake the consumer if it was the
+   first.  Called by cxq_watch, or by cxq_set_mark. */
+static void _set_notify(void *arg, int index) {
+    cxq_set_t *s = arg;
+    if (atomic_fetch_or(&s->ready, BIT64(index)) == 0)
+        SEM_SIGNAL(s->wake);
+}
+
+
+/*
+  Description
+    Init an empty set.
+
+  Parameters
+    s          - Pointer to cxq_set_t struct.
+
+  Returns
+    None
+*/
+void cxq_set_init(cxq_set_t *s) {
+    for (int i = 0; i < CXQ_SET_MAX; i++)
+        s->queues[i] = NULL;
+    atomic_init(&s->ready, 0);
+    SEM_INIT(s->wake, CXQ_SET_SEM_MAX, 0);
+}
+
+
+/*
+  Description
+    De-init the set.  Its queues stop being watched, but are otherwise
+    left alone.
+
+  Parameters
+    s          - Pointer to cxq_set_t struct.
+
+  Returns
+    None
+*/
+void cxq_set_finish(cxq_set_t *s) {
+    for (int i = 0; i < CXQ_SET_MAX; i++)
+        cxq_set_remove(s, i);
+    SEM_DESTROY(s->wake);
+}
+
+
+/*
+  Description
+    Add a queue to the set.  It's flagged ready at once if it already
+    holds data.
+
+  Parameters
+    s          - Pointer to cxq_set_t struct.
+    q          - Pointer to cxq_t struct.  It must not be watched by
+                 another set, and must stay valid until removed.
+
+  Returns
+    The queue's index in the set, its bit in the ready bitmap, or -1 if
+    the set is full.
+*/
+int cxq_set_add(cxq_set_t *s, cxq_t *q) {
+    for (int i = 0; i < CXQ_SET_MAX; i++) {
+        if (!s->queues[i]) {
+            s->queues[i] = q;
+            cxq_watch(q, _set_notify, s, i);
+            if (!cxq_isempty(q))
+                _set_notify(s, i);
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/* Remove the queue at `index` from the set. */
+void cxq_set_remove(cxq_set_t *s, int index) {
+    if (index < 0 || index >= CXQ_SET_MAX || !s->queues[index])
+        return;
+    cxq_watch(s->queues[index], NULL, NULL, 0);
+    s->queues[index] = NULL;
+    atomic_fetch_and(&s->ready, ~BIT64(index));
+}
+
+
+/* Returns the queue at `index`, or NULL. */
+cxq_t * cxq_set_get(const cxq_set_t *s, int index) {
+    if (index < 0 || index >= CXQ_SET_MAX)
+        return NULL;
+    return s->queues[index];
+}
+
+
+/*
+  Description
+    Wait until at least one queue in the set has data, and take the
+    ready bitmap.  Polls CXQ_SPIN_COUNT times, then parks, as
+    cxq_dequeue_wait does.
+
+  Parameters
+    s          - Pointer to cxq_set_t struct.
+    timeout    - Max time to park in ms, or CXQ_WAIT_FOREVER.  0 only
+                 polls.
+
+  Returns
+    Bitmap with bit n set if queue n went from empty to not empty since
+    the last call, or 0 on timeout.  Walk it with cxq_set_next.
+
+  Note
+    One consumer thread per set.  Bits are cleared as they're returned
+    and only set again on the next empty to not empty edge, so dequeue
+    from each ready queue until it's empty, or flag it again with
+    cxq_set_mark.  Without MULTI_THREAD there is nothing to park on,
+    and the call returns 0 once polling fails.
+*/
+uint64_t cxq_set_wait(cxq_set_t *s, uint32_t timeout) {
+    uint64_t ready = 0;
+    for (int i = 0; i < CXQ_SPIN_COUNT && !ready; i++) {
+        if (atomic_load_explicit(&s->ready, memory_order_relaxed))
+            ready = atomic_exchange(&s->ready, 0);
+    }
+#ifdef MULTI_THREAD
+    while (!ready) {
+        /* A post can be left over from bits taken while polling, so
+           wake-ups with nothing ready park again. */
+        int timed_out = SEM_WAIT(s->wake, timeout);
+        ready = atomic_exchange(&s->ready, 0);
+        if (timed_out)
+            break;
+    }
+#else
+    (void)timeout;
+#endif
+    return ready;
+}
+
+
+/*
+  Description
+    Take the lowest set bit of a ready bitmap.
+
+  Parameters
+    ready      - Pointer to a bitmap from cxq_set_wait.  The bit taken
+                 is cleared.
+
+  Returns
+    Index of the queue, or -1 once the bitmap is empty.
+*/
+int cxq_set_next(uint64_t *ready) {
+    if (!*ready)
+        return -1;
+#ifdef __GNUC__
+    int i = __builtin_ctzll(*ready);
+#else
+    int i = 0;
+    while (!(*ready & BIT64(i)))
+        i++;
+#endif
+    *ready &= *ready - 1;
+    return i;
+}
+
+
+/* Flag the queue at `index` as ready, e.g. one left with data after a
+   partial drain, so the next cxq_set_wait returns it. */
+void cxq_set_mark(cxq_set_t *s, int index) {
+    if (index >= 0 && index < CXQ_SET_MAX && s->queues[index])
+        _set_notify(s, index);
+}
@@ -0,0 +1,45 @@
+/******************************************************************************
+
+ cxq_set.h - wait on many queues at once
+
+ A set of up to CXQ_SET_MAX queues behind one wait.  Each member is
+ watched with cxq_watch, and when it goes from empty to not empty its
+ bit is set in a ready bitmap and, if the bitmap was clear, a parked
+ consumer is woken.  cxq_set_wait hands back the whole bitmap and
+ cxq_set_next walks its set bits, so a consumer's work grows with the
+ number of ready queues, not the number of members.
+
+*******************************************************************************/
+
+#ifndef CXQ_SET_H
+#define CXQ_SET_H
+
+#include "cxq.h"
+
+/* Max number of queues, one bit each in `ready`. */
+#define CXQ_SET_MAX     64
+
+typedef struct {
+    cxq_t *queues[CXQ_SET_MAX]; /* Members, NULL where free. */
+    _Atomic uint64_t ready;     /* Bit n set once queue n has data. */
+#ifdef MULTI_THREAD
+    cxq_sem_t wake;             /* Posted when `ready` becomes non-zero. */
+#endif
+} cxq_set_t;
+
+/* construction/destruction */
+void cxq_set_init(cxq_set_t *s);
+void cxq_set_finish(cxq_set_t *s);
+
+/* membership */
+int     cxq_set_add(cxq_set_t *s, cxq_t *q);
+void    cxq_set_remove(cxq_set_t *s, int index);
+cxq_t * cxq_set_get(const cxq_set_t *s, int index);
+
+/* wait for ready queues, timeout in ms or CXQ_WAIT_FOREVER */
+uint64_t cxq_set_wait(cxq_set_t *s, uint32_t timeout);
+int      cxq_set_next(uint64_t *ready);
+void     cxq_set_mark(cxq_set_t *s, int index);
+
+
+#endif /* CXQ_SET_H */
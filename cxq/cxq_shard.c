@@ -0,0 +1,239 @@
+/******************************************************************************
+
+ cxq_shard.c - sharded queue, one cxq_t per producer thread or core
+
+*******************************************************************************/
+
+#ifdef __linux__
+#define _GNU_SOURCE         /* sched_getcpu */
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "cxq_shard.h"
+
+/* Home shard set with cxq_shard_set_home, or -1. */
+static _Thread_local int _home = -1;
+
+
+/* Home shard of the calling thread.  Without a CPU or an explicit
+   home, hash the address of the thread's own _home, which differs per
+   thread and needs no shared counter. */
+static inline int _shard_home(const cxq_shard_t *q) {
+    unsigned h;
+    if (_home >= 0)
+        return _home % q->num_shards;
+#ifdef __linux__
+    if (q->options & CXQ_SHARD_CPU) {
+        int cpu = sched_getcpu();
+        if (cpu >= 0)
+            return cpu % q->num_shards;
+    }
+#endif
+    h = (uintptr_t)&_home >> 6;
+    h ^= h >> 16;
+    h *= 0x45d9f3bU;
+    h ^= h >> 16;
+    return h % q->num_shards;
+}
+
+
+/* Shard i, counting on from `home`. */
+static inline cxq_t * _shard_at(const cxq_shard_t *q, int home, int i) {
+    return &q->shards[(home + i) % q->num_shards].q;
+}
+
+
+/*
+  Description
+    Init the queue.
+
+  Parameters
+    q          - Pointer to cxq_shard_t struct.
+    num_shards - Number of shards, e.g. the number of producer threads
+                 or cores.
+    slots      - Number of queue positions in each shard.
+    data_size  - The size of each queue element.
+    handlers   - Pointer to memfuns_t stuct that manages memory allocation
+                 for queue elements, as for cxq_init.  malloc_fn is called
+                 once per shard.
+    options    - CXQ_SHARD_* flags, or'ed together.  CXQ_SHARD_CPU picks
+                 each thread's home shard by the CPU it runs on, so
+                 threads on one core share a shard.  CXQ_SHARD_SPILL lets
+                 an enqueue go to the next shard with room when the home
+                 shard is full, giving up per-producer order.
+
+  Returns
+    0, or -1 if `num_shards` isn't positive or the shards couldn't be
+    allocated.  The queue is unusable then and must still be finished.
+*/
+int cxq_shard_init(cxq_shard_t *q, int num_shards, int slots, int data_size,
+                   memfuns_t *handlers, int options) {
+    q->num_shards = 0;
+    q->options = options;
+    q->shards = NULL;
+    if (num_shards <= 0)
+        return -1;
+    q->shards = aligned_alloc(_Alignof(cxq_shard_slot_t),
+                              num_shards * sizeof(cxq_shard_slot_t));
+    if (!q->shards)
+        return -1;
+    q->num_shards = num_shards;
+    for (int i = 0; i < num_shards; i++)
+        cxq_init(&q->shards[i].q, slots, data_size, handlers);
+    return 0;
+}
+
+
+/*
+  Description
+    De-init queue, free memory.
+
+  Parameters
+    q          - Pointer to cxq_shard_t struct.
+
+  Returns
+    None
+*/
+void cxq_shard_finish(cxq_shard_t *q) {
+    for (int i = 0; i < q->num_shards; i++)
+        cxq_finish(&q->shards[i].q);
+    free(q->shards);
+}
+
+
+/* Returns the calling thread's home shard in `q`. */
+int cxq_shard_get_home(const cxq_shard_t *q) {return _shard_home(q);}
+
+
+/* Pin the calling thread's home shard, in every cxq_shard_t, or pass
+   -1 to go back to the default. */
+void cxq_shard_set_home(int shard) {_home = shard;}
+
+
+/*
+  Description
+    Add an element to the end of the calling thread's home shard.
+
+  Parameters
+    q          - Pointer to cxq_shard_t struct.
+    data       - Pointer to source memory for enqueued element.
+
+  Returns
+    slot - A pointer to the enqueued data element, or NULL if the home
+    shard is full, or with CXQ_SHARD_SPILL, every shard is.
+*/
+void * cxq_shard_enqueue(cxq_shard_t *q, const void *data) {
+    int home = _shard_home(q);
+    int tries = (q->options & CXQ_SHARD_SPILL) ? q->num_shards : 1;
+    void * slot = NULL;
+    for (int i = 0; i < tries && !slot; i++)
+        slot = cxq_enqueue(_shard_at(q, home, i), data);
+    return slot;
+}
+
+
+/*
+  Description
+    Remove the first element of the calling thread's home shard, or, if
+    it's empty, of the next shard that isn't.
+
+  Parameters
+    q          - Pointer to cxq_shard_t struct.
+    data       - Pointer to destination memory, or NULL, as for
+                 cxq_dequeue.
+    remove     - If false, leave the element in place, as for
+                 cxq_dequeue.
+
+  Returns
+    slot - A pointer to the dequeued data element, or NULL if every
+    shard is empty.
+*/
+void * cxq_shard_dequeue(cxq_shard_t *q, void *data, bool remove) {
+    int home = _shard_home(q);
+    void * slot = NULL;
+    for (int i = 0; i < q->num_shards && !slot; i++) {
+        cxq_t *s = _shard_at(q, home, i);
+        /* Skip empty shards without taking their locks. */
+        if (!cxq_isempty(s))
+            slot = cxq_dequeue(s, data, remove);
+    }
+    return slot;
+}
+
+
+/* Same as cxq_shard_enqueue, but for up to n elements.  Returns num
+   added. */
+int cxq_shard_enqueue_n(cxq_shard_t *q, const void *src, int n) {
+    int home = _shard_home(q);
+    int tries = (q->options & CXQ_SHARD_SPILL) ? q->num_shards : 1;
+    int done = 0;
+    for (int i = 0; i < tries && done < n; i++) {
+        cxq_t *s = _shard_at(q, home, i);
+        done += cxq_enqueue_n(s, src + done * cxq_get_data_size(s), n - done);
+    }
+    return done;
+}
+
+
+/* Same as cxq_shard_dequeue, but for up to n elements, taken from the
+   home shard first and then from the others in turn.  Returns num
+   taken. */
+int cxq_shard_dequeue_n(cxq_shard_t *q, void *dst, int n, bool remove) {
+    int home = _shard_home(q);
+    int done = 0;
+    for (int i = 0; i < q->num_shards && done < n; i++) {
+        cxq_t *s = _shard_at(q, home, i);
+        if (!cxq_isempty(s))
+            done += cxq_dequeue_n(s, dst ? dst + done * cxq_get_data_size(s)
+                                         : NULL, n - done, remove);
+    }
+    return done;
+}
+
+
+/* Returns num of elements in all shards. */
+int cxq_shard_get_count(const cxq_shard_t *q) {
+    int count = 0;
+    for (int i = 0; i < q->num_shards; i++)
+        count += cxq_get_count(&q->shards[i].q);
+    return count;
+}
+
+
+/* Returns num of slots in all shards. */
+int cxq_shard_get_slots(const cxq_shard_t *q) {
+    int slots = 0;
+    for (int i = 0; i < q->num_shards; i++)
+        slots += cxq_get_slots(&q->shards[i].q);
+    return slots;
+}
+
+
+/* Returns true if every shard is empty. */
+bool cxq_shard_isempty(const cxq_shard_t *q) {
+    return cxq_shard_get_count(q) <= 0;
+}
+
+
+/* Returns true if an enqueue from this thread would fail now. */
+bool cxq_shard_isfull(const cxq_shard_t *q) {
+    int home = _shard_home(q);
+    int tries = (q->options & CXQ_SHARD_SPILL) ? q->num_shards : 1;
+    for (int i = 0; i < tries; i++)
+        if (!cxq_isfull(_shard_at(q, home, i)))
+            return false;
+    return true;
+}
+
+
+/* Returns shard `shard`, e.g. to set options on it, or NULL. */
+cxq_t * cxq_shard_get(const cxq_shard_t *q, int shard) {
+    if (shard < 0 || shard >= q->num_shards)
+        return NULL;
+    return &q->shards[shard].q;
+}
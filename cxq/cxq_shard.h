@@ -0,0 +1,67 @@
+/******************************************************************************
+
+ cxq_shard.h - sharded queue, one cxq_t per producer thread or core
+
+ A front-end over several cxq_t shards, each with its own lock, so
+ producers on different threads don't contend.  Each thread has a home
+ shard, picked from its CPU or a per-thread value without touching any
+ shared variable.  Producers enqueue to their home shard; consumers
+ dequeue from their home shard first and steal from the others, in
+ turn, when it's empty.
+
+ Elements are FIFO within a shard, but there is no order across
+ shards.  With the default per-thread home, a producer always enqueues
+ to the same shard, so its elements stay FIFO too.  That doesn't hold
+ with CXQ_SHARD_CPU, where a thread that migrates to another CPU
+ changes shard, or with CXQ_SHARD_SPILL, where a full home shard sends
+ elements elsewhere.
+
+ As with cxq_t, define MULTI_THREAD to use it from several threads.
+
+*******************************************************************************/
+
+#ifndef CXQ_SHARD_H
+#define CXQ_SHARD_H
+
+#include "cxq.h"
+
+/* Options. */
+#define CXQ_SHARD_NONE  0x00
+#define CXQ_SHARD_CPU   0x01    /* Home shard is the current CPU, Linux only. */
+#define CXQ_SHARD_SPILL 0x02    /* Enqueue to another shard if home is full. */
+
+/* A shard on a cache line of its own. */
+typedef struct {
+    _Alignas(CXQ_CACHE_LINE) cxq_t q;
+} cxq_shard_slot_t;
+
+typedef struct {
+    cxq_shard_slot_t *shards;   /* One queue per shard. */
+    int num_shards;         /* Number of shards. */
+    int options;            /* CXQ_SHARD_* flags. */
+} cxq_shard_t;
+
+/* construction/destruction */
+int  cxq_shard_init(cxq_shard_t *q, int num_shards, int slots, int data_size,
+                    memfuns_t *handlers, int options);
+void cxq_shard_finish(cxq_shard_t *q);
+
+/* home shard of the calling thread */
+int  cxq_shard_get_home(const cxq_shard_t *q);
+void cxq_shard_set_home(int shard);
+
+/* enqueue/dequeue */
+void * cxq_shard_enqueue(cxq_shard_t *q, const void *data);
+void * cxq_shard_dequeue(cxq_shard_t *q, void *data, bool remove);
+int    cxq_shard_enqueue_n(cxq_shard_t *q, const void *src, int n);
+int    cxq_shard_dequeue_n(cxq_shard_t *q, void *dst, int n, bool remove);
+
+/* get/isempty/isfull, a snapshot summed over the shards */
+int  cxq_shard_get_count(const cxq_shard_t *q);
+int  cxq_shard_get_slots(const cxq_shard_t *q);
+bool cxq_shard_isempty(const cxq_shard_t *q);
+bool cxq_shard_isfull(const cxq_shard_t *q);
+cxq_t * cxq_shard_get(const cxq_shard_t *q, int shard);
+
+
+#endif /* CXQ_SHARD_H */
@@ -0,0 +1,284 @@
+/******************************************************************************
+
+ cxq_shm.c - single producer/single consumer queue in POSIX shared memory
+
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L /* ftruncate */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cxq_shm.h"
+
+
+/* Copy `name` into the handle.  Returns -1 with ENAMETOOLONG if it
+   doesn't fit. */
+static int _shm_name(cxq_shm_t *q, const char *name) {
+    if (strlen(name) >= sizeof(q->name)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(q->name, name);
+    return 0;
+}
+
+
+/* Map `size` bytes of q->fd and fill in the process-local handle. */
+static int _shm_map(cxq_shm_t *q, size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, q->fd, 0);
+    if (p == MAP_FAILED)
+        return -1;
+    q->hdr = p;
+    q->map_size = size;
+    return 0;
+}
+
+
+/*
+  Description
+    Create a shared memory segment and init a queue in it.
+
+  Parameters
+    q          - Pointer to cxq_shm_t handle.
+    name       - Shared memory object name, e.g. "/my_queue", shorter
+                 than 64 bytes.
+    slots      - Number of queue positions, rounded up to a power of two.
+    data_size  - The size of each queue element.
+
+  Returns
+    0 on success, -1 with errno set on failure.  Fails with EEXIST if
+    the segment already exists; shm_unlink a stale one first, and with
+    ENAMETOOLONG if `name` is too long, and with EINVAL if `slots` or
+    `data_size` isn't positive.
+*/
+int cxq_shm_create(cxq_shm_t *q, const char *name, int slots, int data_size) {
+    if (slots <= 0 || data_size <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    slots = cxq_pow2_roundup(slots);
+    size_t data_offset = (sizeof(cxq_shm_hdr_t) + CXQ_CACHE_LINE - 1)
+                         & ~(size_t)(CXQ_CACHE_LINE - 1);
+    size_t size = data_offset + (size_t)slots * data_size;
+
+    if (_shm_name(q, name) < 0)
+        return -1;
+    q->owner = true;
+    q->fd = shm_open(q->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (q->fd < 0)
+        return -1;
+    if (ftruncate(q->fd, size) < 0 || _shm_map(q, size) < 0) {
+        int err = errno;
+        close(q->fd);
+        shm_unlink(q->name);
+        errno = err;
+        return -1;
+    }
+
+    cxq_shm_hdr_t *hdr = q->hdr;
+    hdr->version = CXQ_SHM_VERSION;
+    hdr->slots = slots;
+    hdr->data_size = data_size;
+    hdr->data_offset = data_offset;
+    atomic_init(&hdr->head, 0);
+    atomic_init(&hdr->tail, 0);
+    q->data = (char *)hdr + data_offset;
+    q->mask = slots - 1;
+    q->slots = slots;
+    q->data_size = data_size;
+    /* Publish last, so an attacher never sees a half built header. */
+    atomic_store_explicit(&hdr->magic, CXQ_SHM_MAGIC, memory_order_release);
+    return 0;
+}
+
+
+/*
+  Description
+    Attach to a queue created by another process with cxq_shm_create.
+
+  Parameters
+    q          - Pointer to cxq_shm_t handle.
+    name       - Shared memory object name given to cxq_shm_create.
+
+  Returns
+    0 on success, -1 with errno set on failure.  Fails with EAGAIN if
+    the creator hasn't finished initializing the queue yet, with EPROTO
+    if the segment isn't a queue of this version or its header doesn't
+    fit the segment, and with ENAMETOOLONG if `name` is too long.
+*/
+int cxq_shm_attach(cxq_shm_t *q, const char *name) {
+    struct stat st;
+
+    if (_shm_name(q, name) < 0)
+        return -1;
+    q->owner = false;
+    q->fd = shm_open(q->name, O_RDWR, 0600);
+    if (q->fd < 0)
+        return -1;
+    if (fstat(q->fd, &st) < 0) {
+        int err = errno;
+        close(q->fd);
+        errno = err;
+        return -1;
+    }
+    /* Not sized by the creator yet. */
+    if (st.st_size == 0) {
+        close(q->fd);
+        errno = EAGAIN;
+        return -1;
+    }
+    if (_shm_map(q, st.st_size) < 0) {
+        int err = errno;
+        close(q->fd);
+        errno = err;
+        return -1;
+    }
+
+    cxq_shm_hdr_t *hdr = q->hdr;
+    if (q->map_size < sizeof(cxq_shm_hdr_t)
+        || atomic_load_explicit(&hdr->magic, memory_order_acquire)
+           != CXQ_SHM_MAGIC) {
+        cxq_shm_detach(q);
+        errno = EAGAIN;
+        return -1;
+    }
+    /* Read the geometry once, then check it against the mapping; only
+       the copies are used from here on. */
+    int slots = hdr->slots, data_size = hdr->data_size;
+    size_t data_offset = hdr->data_offset;
+    if (hdr->version != CXQ_SHM_VERSION
+        || slots <= 0 || (slots & (slots - 1)) || data_size <= 0
+        || data_offset < sizeof(cxq_shm_hdr_t)
+        || data_offset > q->map_size
+        || (q->map_size - data_offset) / slots < (size_t)data_size) {
+        cxq_shm_detach(q);
+        errno = EPROTO;
+        return -1;
+    }
+    q->data = (char *)hdr + data_offset;
+    q->mask = slots - 1;
+    q->slots = slots;
+    q->data_size = data_size;
+    return 0;
+}
+
+
+/* Unmap the queue.  The creator also removes the segment name; the
+   memory is released once every process has detached. */
+void cxq_shm_detach(cxq_shm_t *q) {
+    munmap(q->hdr, q->map_size);
+    close(q->fd);
+    if (q->owner)
+        shm_unlink(q->name);
+    q->hdr = NULL;
+    q->data = NULL;
+}
+
+
+/* Slot at position `pos`. */
+static inline void * _shm_slot(const cxq_shm_t *q, unsigned pos) {
+    return q->data + (pos & q->mask) * q->data_size;
+}
+
+
+/*
+  Description
+    Reserve the slot at end of queue so the producer can fill it in
+    place, then publish it with cxq_shm_commit.  Producer only.
+
+  Returns
+    A pointer to the slot in this process's mapping, or NULL if full.
+*/
+void * cxq_shm_reserve(cxq_shm_t *q) {
+    unsigned tail = atomic_load_explicit(&q->hdr->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->hdr->head, memory_order_acquire);
+    if ((int)(tail - head) >= q->slots)
+        return NULL;
+    return _shm_slot(q, tail);
+}
+
+
+/* Publish the slot returned by cxq_shm_reserve.  Producer only. */
+void cxq_shm_commit(cxq_shm_t *q) {
+    unsigned tail = atomic_load_explicit(&q->hdr->tail, memory_order_relaxed);
+    atomic_store_explicit(&q->hdr->tail, tail + 1, memory_order_release);
+}
+
+
+/*
+  Description
+    Get a pointer to the first element in place.  It stays valid until
+    cxq_shm_release.  Consumer only.
+
+  Returns
+    A pointer to the slot in this process's mapping, or NULL if empty.
+*/
+void * cxq_shm_peek(cxq_shm_t *q) {
+    unsigned head = atomic_load_explicit(&q->hdr->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->hdr->tail, memory_order_acquire);
+    if (head == tail)
+        return NULL;
+    return _shm_slot(q, head);
+}
+
+
+/* Remove the element returned by cxq_shm_peek.  Consumer only. */
+void cxq_shm_release(cxq_shm_t *q) {
+    unsigned head = atomic_load_explicit(&q->hdr->head, memory_order_relaxed);
+    atomic_store_explicit(&q->hdr->head, head + 1, memory_order_release);
+}
+
+
+/* Copy an element to end of queue.  Returns the slot, or NULL if full. */
+void * cxq_shm_enqueue(cxq_shm_t *q, const void *data) {
+    void * slot = cxq_shm_reserve(q);
+    if (slot) {
+        memcpy(slot, data, q->data_size);
+        cxq_shm_commit(q);
+    }
+    return slot;
+}
+
+
+/* Copy the first element out and remove it.  Returns the slot it came
+   from, or NULL if empty. */
+void * cxq_shm_dequeue(cxq_shm_t *q, void *data) {
+    void * slot = cxq_shm_peek(q);
+    if (slot) {
+        memcpy(data, slot, q->data_size);
+        cxq_shm_release(q);
+    }
+    return slot;
+}
+
+
+/* Returns num of elements in queue. */
+int cxq_shm_get_count(const cxq_shm_t *q) {
+    unsigned head = atomic_load_explicit(&q->hdr->head, memory_order_acquire);
+    unsigned tail = atomic_load_explicit(&q->hdr->tail, memory_order_acquire);
+    return (int)(tail - head);
+}
+
+
+/* Returns number of data slots. */
+int cxq_shm_get_slots(const cxq_shm_t *q) {return q->slots;}
+
+
+/* Returns data size of a queue element. */
+int cxq_shm_get_data_size(const cxq_shm_t *q) {return q->data_size;}
+
+
+/* Returns true if queue is empty. */
+bool cxq_shm_isempty(const cxq_shm_t *q) {return cxq_shm_get_count(q) <= 0;}
+
+
+/* Returns true if queue is full. */
+bool cxq_shm_isfull(const cxq_shm_t *q) {
+    return cxq_shm_get_count(q) >= q->slots;
+}
@@ -0,0 +1,80 @@
+/******************************************************************************
+
+ cxq_shm.h - single producer/single consumer queue in POSIX shared memory
+
+ The queue header, indices and slots all live in one shm_open/mmap
+ segment, and the header locates the slots by offset, so separate
+ processes can map it at different addresses.  One process enqueues and
+ one dequeues, lock-free, with the same acquire/release protocol as
+ CXQ_OPT_SPSC.  Both sides can work on slots in place with
+ reserve/commit and peek/release.
+
+ The geometry is copied out of the header when the queue is created or
+ attached, so a peer that scribbles on the header later can't steer
+ accesses outside the mapping.
+
+ Nothing process-local is stored in the mapping, so there are no
+ memfuns_t handlers: elements are copied with memcpy and must not hold
+ pointers.  Linux/POSIX only; link with -lrt on older C libraries.
+
+*******************************************************************************/
+
+#ifndef CXQ_SHM_H
+#define CXQ_SHM_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "cxq.h"
+
+#define CXQ_SHM_MAGIC   0x43585153U     /* "CXQS" */
+#define CXQ_SHM_VERSION 1
+
+/* Header at the start of the mapping.  Offsets only, no pointers. */
+typedef struct {
+    atomic_uint magic;      /* CXQ_SHM_MAGIC once initialized. */
+    uint32_t version;       /* CXQ_SHM_VERSION. */
+    int slots;              /* Num of queue slots, a power of two. */
+    int data_size;          /* Size of each queue element. */
+    size_t data_offset;     /* Offset of slot 0 from the header. */
+    _Alignas(CXQ_CACHE_LINE) atomic_uint head;  /* Consumer position. */
+    _Alignas(CXQ_CACHE_LINE) atomic_uint tail;  /* Producer position. */
+} cxq_shm_hdr_t;
+
+/* Process-local handle. */
+typedef struct {
+    cxq_shm_hdr_t *hdr;     /* This process's mapping of the header. */
+    void *data;             /* This process's mapping of slot 0. */
+    unsigned mask;          /* slots - 1. */
+    int slots;              /* Copy of hdr->slots, checked at attach. */
+    int data_size;          /* Copy of hdr->data_size, checked at attach. */
+    size_t map_size;        /* Bytes mapped. */
+    int fd;                 /* Shared memory object. */
+    bool owner;             /* Created the segment; unlinks it. */
+    char name[64];          /* Shared memory object name. */
+} cxq_shm_t;
+
+/* construction/destruction, return 0 or -1 with errno set */
+int  cxq_shm_create(cxq_shm_t *q, const char *name, int slots, int data_size);
+int  cxq_shm_attach(cxq_shm_t *q, const char *name);
+void cxq_shm_detach(cxq_shm_t *q);
+
+/* enqueue/dequeue, producer/consumer only */
+void * cxq_shm_enqueue(cxq_shm_t *q, const void *data);
+void * cxq_shm_dequeue(cxq_shm_t *q, void *data);
+
+/* zero-copy reserve/commit (producer) and peek/release (consumer) */
+void * cxq_shm_reserve(cxq_shm_t *q);
+void   cxq_shm_commit(cxq_shm_t *q);
+void * cxq_shm_peek(cxq_shm_t *q);
+void   cxq_shm_release(cxq_shm_t *q);
+
+/* get/isempty/isfull */
+int  cxq_shm_get_count(const cxq_shm_t *q);
+int  cxq_shm_get_slots(const cxq_shm_t *q);
+int  cxq_shm_get_data_size(const cxq_shm_t *q);
+bool cxq_shm_isempty(const cxq_shm_t *q);
+bool cxq_shm_isfull(const cxq_shm_t *q);
+
+
+#endif /* CXQ_SHM_H */
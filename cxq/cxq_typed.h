@@ -0,0 +1,119 @@
+/******************************************************************************
+
+ cxq_typed.h - type specialized queue generated at compile time
+
+ CXQ_DECLARE(name, T, N) generates a queue type `name_t` holding up to N
+ elements of type T, and a set of static inline functions `name_init`,
+ `name_enqueue`, ... that mirror the cxq API.  Element size and capacity
+ are compile-time constants, storage is inline in the struct, and
+ elements are copied by plain assignment, so the compiler can inline and
+ vectorize the copy.  Positions are unsigned, so `% N` becomes a mask
+ when N is a power of two.
+
+ Use it for queues of plain data, where cxq's memfuns_t handlers aren't
+ needed.  The generated queue has no lock; guard it yourself if it's
+ shared between threads.
+
+ Example:
+    CXQ_DECLARE(intq, int, 16)
+
+    intq_t q;
+    intq_init(&q);
+    int i = 5;
+    intq_enqueue(&q, &i);
+
+*******************************************************************************/
+
+#ifndef CXQ_TYPED_H
+#define CXQ_TYPED_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define CXQ_DECLARE(name, T, N)                                             \
+                                                                            \
+typedef struct {                                                            \
+    T data[N];              /* Body of queue. */                            \
+    unsigned first;         /* Position of first element. */                \
+    unsigned count;         /* Number of queue elements. */                 \
+    bool circular;          /* This is a circular buffer. */                \
+} name##_t;                                                                 \
+                                                                            \
+static inline void name##_init(name##_t *q) {                               \
+    q->first = 0;                                                           \
+    q->count = 0;                                                           \
+    q->circular = false;                                                    \
+}                                                                           \
+                                                                            \
+static inline void name##_set_circular(name##_t *q) {q->circular = true;}   \
+static inline bool name##_get_circular(const name##_t *q) {                 \
+    return q->circular;                                                     \
+}                                                                           \
+static inline int name##_get_count(const name##_t *q) {return q->count;}    \
+static inline int name##_get_slots(const name##_t *q) {                     \
+    (void)q;                                                                \
+    return (N);                                                             \
+}                                                                           \
+static inline bool name##_isempty(const name##_t *q) {return q->count == 0;}\
+static inline bool name##_isfull(const name##_t *q) {                       \
+    return q->count >= (N);                                                 \
+}                                                                           \
+static inline int name##_slots_empty(const name##_t *q) {                   \
+    return (N) - q->count;                                                  \
+}                                                                           \
+static inline int name##_slots_filled(const name##_t *q) {                  \
+    return q->count;                                                        \
+}                                                                           \
+                                                                            \
+static inline T * name##_dequeue(name##_t *q, T *data, bool remove) {       \
+    if (q->count == 0)                                                      \
+        return NULL;                                                        \
+    T *slot = &q->data[q->first];                                           \
+    if (data) *data = *slot;                                                \
+    if (remove) {                                                           \
+        q->first = (q->first + 1) % (N);                                    \
+        q->count--;                                                         \
+    }                                                                       \
+    return slot;                                                            \
+}                                                                           \
+                                                                            \
+static inline T * name##_enqueue(name##_t *q, const T *data) {              \
+    if (q->count >= (N)) {                                                  \
+        if (!q->circular)                                                   \
+            return NULL;                                                    \
+        name##_dequeue(q, NULL, true);                                      \
+    }                                                                       \
+    T *slot = &q->data[(q->first + q->count) % (N)];                        \
+    *slot = *data;                                                          \
+    q->count++;                                                             \
+    return slot;                                                            \
+}                                                                           \
+                                                                            \
+static inline T * name##_enqueue_front(name##_t *q, const T *data) {        \
+    if (q->count >= (N)) {                                                  \
+        if (!q->circular)                                                   \
+            return NULL;                                                    \
+        name##_dequeue(q, NULL, true);                                      \
+    }                                                                       \
+    q->first = q->first ? q->first - 1 : (N) - 1;                           \
+    T *slot = &q->data[q->first];                                           \
+    *slot = *data;                                                          \
+    q->count++;                                                             \
+    return slot;                                                            \
+}                                                                           \
+                                                                            \
+static inline void name##_flush(name##_t *q) {                              \
+    q->first = (q->first + q->count) % (N);                                 \
+    q->count = 0;                                                           \
+}                                                                           \
+                                                                            \
+static inline void name##_traverse(const name##_t *q,                       \
+                                   void (*peekfun)(const T *data)) {        \
+    unsigned index = q->first;                                              \
+    for (unsigned i = 0; i < q->count; i++) {                               \
+        peekfun(&q->data[index]);                                           \
+        index = (index + 1) % (N);                                          \
+    }                                                                       \
+}
+
+#endif /* CXQ_TYPED_H */
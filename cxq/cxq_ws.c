@@ -0,0 +1,155 @@
+/******************************************************************************
+
+ cxq_ws.c - Chase-Lev work-stealing deque
+
+ Bounded version of Chase and Lev's deque, with the C11 memory orders
+ of Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient
+ Work-Stealing for Weak Memory Models", except that push publishes
+ with a release store to `bottom` in place of a release fence.  `top`
+ and `bottom` only grow, so elements live in slot index & (slots - 1)
+ and the deque holds bottom - top elements.
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cxq_ws.h"
+
+
+/* Address of the slot for index i. */
+static inline void * _ws_slot(const cxq_ws_t *q, long long i) {
+    return q->data + (i & (q->slots - 1)) * q->data_size;
+}
+
+
+/*
+  Description
+    Init the deque.
+
+  Parameters
+    q          - Pointer to cxq_ws_t struct.
+    slots      - Number of deque positions, rounded up to a power of two.
+    data_size  - The size of each element.
+
+  Returns
+    None
+*/
+void cxq_ws_init(cxq_ws_t *q, int slots, int data_size) {
+    q->slots = cxq_pow2_roundup(slots);
+    q->data_size = data_size;
+    q->data = malloc((size_t)q->slots * data_size);
+    atomic_init(&q->top, 0);
+    atomic_init(&q->bottom, 0);
+}
+
+
+/*
+  Description
+    De-init deque, free memory.
+
+  Parameters
+    q          - Pointer to cxq_ws_t struct.
+
+  Returns
+    None
+*/
+void cxq_ws_finish(cxq_ws_t *q) {
+    free(q->data);
+}
+
+
+/*
+  Description
+    Push an element at the bottom.  Owner only.
+
+  Parameters
+    q          - Pointer to cxq_ws_t struct.
+    data       - Pointer to source memory for the element.
+
+  Returns
+    true, or false if the deque is full.
+*/
+bool cxq_ws_push(cxq_ws_t *q, const void *data) {
+    long long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    long long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    if (b - t >= q->slots)
+        return false;
+    memcpy(_ws_slot(q, b), data, q->data_size);
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_release);
+    return true;
+}
+
+
+/*
+  Description
+    Pop the newest element from the bottom.  Owner only.
+
+  Parameters
+    q          - Pointer to cxq_ws_t struct.
+    data       - Pointer to destination memory for the element.
+
+  Returns
+    true, or false if the deque is empty, or a thief took the last
+    element first.
+*/
+bool cxq_ws_pop(cxq_ws_t *q, void *data) {
+    long long b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long t = atomic_load_explicit(&q->top, memory_order_relaxed);
+    bool ok = true;
+    if (t <= b) {
+        memcpy(data, _ws_slot(q, b), q->data_size);
+        if (t == b) {
+            /* Last element, race the thieves for it. */
+            ok = atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                    memory_order_seq_cst, memory_order_relaxed);
+            atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        /* Empty. */
+        ok = false;
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    }
+    return ok;
+}
+
+
+/*
+  Description
+    Steal the oldest element from the top.  Any thread.
+
+  Parameters
+    q          - Pointer to cxq_ws_t struct.
+    data       - Pointer to destination memory for the element.  It may
+                 be written even when the steal fails.
+
+  Returns
+    CXQ_WS_OK, CXQ_WS_EMPTY, or CXQ_WS_ABORT if the element was taken
+    by the owner or another thief first.
+*/
+int cxq_ws_steal(cxq_ws_t *q, void *data) {
+    long long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+    if (t >= b)
+        return CXQ_WS_EMPTY;
+    memcpy(data, _ws_slot(q, t), q->data_size);
+    if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed))
+        return CXQ_WS_ABORT;
+    return CXQ_WS_OK;
+}
+
+
+/* Returns num of elements in deque. */
+int cxq_ws_get_count(cxq_ws_t *q) {
+    long long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    long long t = atomic_load_explicit(&q->top, memory_order_relaxed);
+    return (b > t) ? (int)(b - t) : 0;
+}
+
+
+/* Returns true if deque is empty. */
+bool cxq_ws_isempty(cxq_ws_t *q) {return cxq_ws_get_count(q) <= 0;}
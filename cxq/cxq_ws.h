@@ -0,0 +1,59 @@
+/******************************************************************************
+
+ cxq_ws.h - Chase-Lev work-stealing deque
+
+ One owner thread pushes and pops at the bottom without locks or
+ read-modify-writes, except for a CAS when it takes the last element.
+ Any number of thieves steal from the top with a CAS, so the owner
+ works depth first on its newest elements while idle threads take its
+ oldest ones.  The deque is bounded; slots are rounded up to a power
+ of two.
+
+ A thief copies an element out before its CAS, and throws the copy away
+ if the CAS fails, so elements are copied with memcpy and there are no
+ memfuns_t handlers: use plain data, such as task descriptors.
+
+*******************************************************************************/
+
+#ifndef CXQ_WS_H
+#define CXQ_WS_H
+
+#include <stdatomic.h>
+
+#include "cxq.h"
+
+/* cxq_ws_steal results. */
+#define CXQ_WS_EMPTY    0       /* Nothing to steal. */
+#define CXQ_WS_OK       1       /* Stole an element. */
+#define CXQ_WS_ABORT    (-1)    /* Lost a race, try again or elsewhere. */
+
+/* `top` and `bottom` are padded a cache line apart, rather than aligned,
+   so the struct can be malloc'd. */
+typedef struct {
+    void *data;             /* Pointer to body of deque. */
+    int slots;              /* Num of slots, a power of two. */
+    int data_size;          /* Size of each element. */
+    char pad0[CXQ_CACHE_LINE];
+    atomic_llong top;       /* Thieves' end. */
+    char pad1[CXQ_CACHE_LINE - sizeof(atomic_llong)];
+    atomic_llong bottom;    /* Owner's end. */
+    char pad2[CXQ_CACHE_LINE - sizeof(atomic_llong)];
+} cxq_ws_t;
+
+/* construction/destruction */
+void cxq_ws_init(cxq_ws_t *q, int slots, int data_size);
+void cxq_ws_finish(cxq_ws_t *q);
+
+/* owner push/pop at the bottom */
+bool cxq_ws_push(cxq_ws_t *q, const void *data);
+bool cxq_ws_pop(cxq_ws_t *q, void *data);
+
+/* any thread, steal from the top */
+int  cxq_ws_steal(cxq_ws_t *q, void *data);
+
+/* count/isempty, a snapshot while other threads run */
+int  cxq_ws_get_count(cxq_ws_t *q);
+bool cxq_ws_isempty(cxq_ws_t *q);
+
+
+#endif /* CXQ_WS_H */